@@ -0,0 +1,91 @@
+// Microbenchmark dos layouts de OccupancyGrid: os mesmos raios de sonar do mapeamento HIMM
+// (decrementa o caminho, reforça a vizinhança 3x3 do fim) sobre row-major, blocos e Morton.
+// Sai com código 1 se os layouts não chegarem à mesma grade.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "LineTraversal.hpp"
+#include "OccupancyGrid.hpp"
+
+namespace {
+
+const GridInfo GRID = {-1.0f, 1.0f, 0.005f};
+const int RAYS = 1000000;
+
+struct Result {
+    double seconds;
+    long checksum;
+};
+
+template <typename Layout>
+Result run(const std::vector<float>& rays)
+{
+    OccupancyGrid<int, Layout> cells(GRID, 8);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < RAYS; ++r) {
+        traverseRay(GRID, rays[4 * r], rays[4 * r + 1], rays[4 * r + 2], rays[4 * r + 3],
+            [&](const MatrixPosition& pos, float, float, bool last) {
+                if (!cells.isValid(pos)) return false;
+                if (!last) {
+                    cells(pos.linha, pos.coluna) = std::max(0, cells(pos.linha, pos.coluna) - 1);
+                    return true;
+                }
+                for (int i = pos.linha - 1; i <= pos.linha + 1; ++i)
+                    for (int j = pos.coluna - 1; j <= pos.coluna + 1; ++j)
+                        if (cells.isValid({i, j})) cells(i, j) = std::min(15, cells(i, j) + 1);
+                return true;
+            });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long checksum = 0;
+    for (int i = 0; i < cells.rows(); ++i)
+        for (int j = 0; j < cells.cols(); ++j) checksum = checksum * 31 + cells(i, j);
+    return {seconds, checksum};
+}
+
+}
+
+int main()
+{
+    // Raios curtos (alcance do sonar) sorteados uma vez e repetidos em cada layout
+    const float RANGE = 2.0f * 0.03f;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-0.9f, 0.9f), angle(-3.14159265f, 3.14159265f),
+        distance(0.0f, RANGE);
+    std::vector<float> rays(4 * RAYS);
+    for (int r = 0; r < RAYS; ++r) {
+        float x = position(rng), y = position(rng), a = angle(rng), d = distance(rng);
+        rays[4 * r] = x;
+        rays[4 * r + 1] = y;
+        rays[4 * r + 2] = x + std::cos(a) * d;
+        rays[4 * r + 3] = y + std::sin(a) * d;
+    }
+
+    run<RowMajorLayout>(rays);  // aquece páginas e caches antes de medir
+
+    struct Entry {
+        const char* name;
+        Result result;
+    } entries[] = {
+        {"row-major", run<RowMajorLayout>(rays)},
+        {"blocos 8x8", run<TiledLayout<3>>(rays)},
+        {"blocos 16x16", run<TiledLayout<4>>(rays)},
+        {"Morton 8x8", run<MortonLayout<3>>(rays)},
+        {"Morton 16x16", run<MortonLayout<4>>(rays)},
+    };
+
+    bool same = true;
+    for (const Entry& e : entries) {
+        std::printf("%-13s %7.1f ns por raio (%.2fx row-major)\n", e.name, e.result.seconds * 1e9 / RAYS,
+                    entries[0].result.seconds / e.result.seconds);
+        same = same && e.result.checksum == entries[0].result.checksum;
+    }
+    if (!same) std::printf("layouts divergiram\n");
+    return same ? 0 : 1;
+}
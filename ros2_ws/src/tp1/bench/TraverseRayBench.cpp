@@ -0,0 +1,75 @@
+// Microbenchmark de traverseRay: raios de sonar em todas as direções sobre a grade do mapa,
+// contando as alocações no heap durante as travessias (operator new global substituído).
+// Sai com código 1 se algum raio alocar.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "BitGrid.hpp"
+#include "LineTraversal.hpp"
+#include "OccupancyGrid.hpp"
+
+namespace {
+
+long allocations = 0;
+
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main()
+{
+    GridInfo grid = {-1.0f, 1.0f, 0.005f};
+    OccupancyGrid<int> cells(grid, 8);
+    BitGrid known;
+    known.reset(cells.rows(), cells.cols(), grid);
+
+    // Origens e direções sorteadas antes de medir, para o vetor não entrar na contagem
+    const int RAYS = 1000000;
+    const float RANGE = 2.0f * 0.03f;  // alcance do sonar em unidades do mapa (maxRange * scaleFactor)
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-0.9f, 0.9f), angle(-3.14159265f, 3.14159265f),
+        distance(0.0f, RANGE);
+    std::vector<float> rays(4 * RAYS);
+    for (int r = 0; r < RAYS; ++r) {
+        float x = position(rng), y = position(rng), a = angle(rng), d = distance(rng);
+        rays[4 * r] = x;
+        rays[4 * r + 1] = y;
+        rays[4 * r + 2] = x + std::cos(a) * d;
+        rays[4 * r + 3] = y + std::sin(a) * d;
+    }
+
+    long visited = 0;
+    long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < RAYS; ++r) {
+        traverseRay(grid, rays[4 * r], rays[4 * r + 1], rays[4 * r + 2], rays[4 * r + 3],
+            [&](const MatrixPosition& pos, float, float, bool last) {
+                if (!cells.isValid(pos)) return false;
+                if (!last) cells[pos] = std::max(0, cells[pos] - 1);
+                known.setKnown(pos);
+                ++visited;
+                return true;
+            });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long allocated = allocations - before;
+
+    std::printf("%d raios, %.1f células por raio, %.1f ns por raio, %.3f alocações por raio\n",
+                RAYS, static_cast<double>(visited) / RAYS, seconds * 1e9 / RAYS,
+                static_cast<double>(allocated) / RAYS);
+    return allocated == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+// BitGrid.hpp
+#ifndef BITGRID_HPP
+#define BITGRID_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "OccupancyGrid.hpp"
+
+// Grade de bits (um bit por célula) em palavras de 64 bits, com cada linha alinhada a 64 bytes.
+// Mantém a contagem de células marcadas a cada setKnown; recount() refaz a soma com popcount.
+class BitGrid {
+public:
+    BitGrid() = default;
+    BitGrid(const BitGrid&) = delete;
+    BitGrid& operator=(const BitGrid&) = delete;
+
+    void reset(int rows, int cols, const GridInfo& info) {
+        cols_ = cols;
+        words_.reset(rows, (cols + 63) / 64, info, 0);
+        count_ = 0;
+    }
+
+    void clear() {
+        words_.fill(0);
+        count_ = 0;
+    }
+
+    bool get(int linha, int coluna) const {
+        return (words_(linha, coluna >> 6) >> (coluna & 63)) & 1u;
+    }
+
+    bool get(const MatrixPosition& pos) const { return get(pos.linha, pos.coluna); }
+
+    bool isValid(const MatrixPosition& pos) const {
+        return pos.linha >= 0 && pos.linha < rows() && pos.coluna >= 0 && pos.coluna < cols_;
+    }
+
+    // Marca a célula como conhecida; retorna true se ela ainda não era
+    bool setKnown(const MatrixPosition& pos) {
+        uint64_t& word = words_(pos.linha, pos.coluna >> 6);
+        uint64_t bit = uint64_t(1) << (pos.coluna & 63);
+        bool novo = !(word & bit);
+        word |= bit;
+        count_.fetch_add(novo, std::memory_order_relaxed);
+        return novo;
+    }
+
+    // Chama visit(inicio, fim) para cada sequência de colunas marcadas [inicio, fim) da linha
+    template <typename Visitor>
+    void forEachSpan(int linha, Visitor&& visit) const {
+        const uint64_t* words = words_.row(linha);
+        int wordCount = words_.cols();
+        int begin = -1;
+
+        for (int w = 0; w < wordCount; ++w) {
+            uint64_t word = words[w];
+            int base = w * 64;
+
+            // Palavras cheias ou vazias continuam ou fecham a sequência de uma vez
+            if (word == ~uint64_t(0)) {
+                if (begin < 0) begin = base;
+                continue;
+            }
+            if (word == 0) {
+                if (begin >= 0) {
+                    visit(begin, base);
+                    begin = -1;
+                }
+                continue;
+            }
+
+            int bit = 0;
+            while (bit < 64) {
+                uint64_t rest = word >> bit;
+                if (begin < 0) {
+                    if (rest == 0) break;
+                    bit += __builtin_ctzll(rest);
+                    begin = base + bit;
+                } else {
+                    uint64_t holes = ~rest;
+                    if (holes == 0) break;
+                    bit += __builtin_ctzll(holes);
+                    if (bit >= 64) break;
+                    visit(begin, base + bit);
+                    begin = -1;
+                }
+            }
+        }
+
+        if (begin >= 0) visit(begin, cols_);
+    }
+
+    std::size_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    std::size_t recount() {
+        std::size_t total = 0;
+        for (int linha = 0; linha < words_.rows(); ++linha) {
+            const uint64_t* words = words_.row(linha);
+            for (int w = 0; w < words_.cols(); ++w) total += __builtin_popcountll(words[w]);
+        }
+        count_ = total;
+        return total;
+    }
+
+    // Fração da grade já explorada, de 0 a 1
+    float coverage() const {
+        std::size_t cells = static_cast<std::size_t>(rows()) * cols_;
+        return cells ? static_cast<float>(count()) / cells : 0.0f;
+    }
+
+    int rows() const { return words_.rows(); }
+    int cols() const { return cols_; }
+    bool empty() const { return words_.empty(); }
+    const GridInfo& info() const { return words_.info(); }
+
+    const uint64_t* row(int linha) const { return words_.row(linha); }
+
+private:
+    int cols_ = 0;
+    OccupancyGrid<uint64_t> words_;
+    std::atomic<std::size_t> count_{0};
+};
+
+#endif // BITGRID_HPP
@@ -0,0 +1,68 @@
+// LineTraversal.hpp
+#ifndef LINETRAVERSAL_HPP
+#define LINETRAVERSAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "OccupancyGrid.hpp"
+
+// Travessia de Amanatides-Woo: percorre, a partir da posição real (x0, y0), todas as células
+// cruzadas pelo segmento até (x1, y1), cada uma exatamente uma vez e sem alocar nada.
+// Chama visit(celula, tEntrada, tSaida, ultima), com as distâncias medidas ao longo do raio
+// em unidades do mapa. Se visit retornar false o percurso é interrompido.
+template <typename Visitor>
+void traverseRay(const GridInfo& info, float x0, float y0, float x1, float y1, Visitor&& visit) {
+    const float INF = std::numeric_limits<float>::infinity();
+
+    float dx = x1 - x0,
+        dy = y1 - y0,
+        length = std::sqrt(dx * dx + dy * dy);
+
+    MatrixPosition cell = {static_cast<int>(std::floor((y0 - info.inicio) / info.passo)),
+                           static_cast<int>(std::floor((x0 - info.inicio) / info.passo))};
+    MatrixPosition end = {static_cast<int>(std::floor((y1 - info.inicio) / info.passo)),
+                          static_cast<int>(std::floor((x1 - info.inicio) / info.passo))};
+
+    if (length <= 0.0f) {
+        visit(cell, 0.0f, 0.0f, true);
+        return;
+    }
+
+    float ux = dx / length,
+        uy = dy / length;
+
+    int stepColumn = ux > 0.0f ? 1 : (ux < 0.0f ? -1 : 0),
+        stepLine = uy > 0.0f ? 1 : (uy < 0.0f ? -1 : 0);
+
+    // Distância até a primeira borda de célula em cada eixo e distância entre bordas consecutivas
+    float tMaxX = stepColumn == 0 ? INF
+        : (info.inicio + (cell.coluna + (stepColumn > 0)) * info.passo - x0) / ux;
+    float tMaxY = stepLine == 0 ? INF
+        : (info.inicio + (cell.linha + (stepLine > 0)) * info.passo - y0) / uy;
+    float tDeltaX = stepColumn == 0 ? INF : info.passo / std::abs(ux);
+    float tDeltaY = stepLine == 0 ? INF : info.passo / std::abs(uy);
+
+    // Folga para o ponto final cair exatamente sobre uma borda: a célula final é a mesma de findCell
+    const float SLACK = 1e-3f * info.passo;
+
+    float tEnter = 0.0f;
+    while (true) {
+        float tNext = std::min(tMaxX, tMaxY);
+        bool last = (cell.linha == end.linha && cell.coluna == end.coluna) || tNext >= length + SLACK;
+
+        if (!visit(cell, tEnter, last ? std::max(tEnter, length) : tNext, last) || last) return;
+
+        tEnter = tNext;
+        if (tMaxX < tMaxY) {
+            cell.coluna += stepColumn;
+            tMaxX += tDeltaX;
+        } else {
+            cell.linha += stepLine;
+            tMaxY += tDeltaY;
+        }
+    }
+}
+
+#endif // LINETRAVERSAL_HPP
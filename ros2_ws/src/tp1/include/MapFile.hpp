@@ -0,0 +1,81 @@
+// MapFile.hpp
+#ifndef MAPFILE_HPP
+#define MAPFILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "NibbleGrid.hpp"
+
+// Formato binário do mapa: cabeçalho de 64 bytes seguido das linhas da grade exatamente como
+// estão na memória (com o mesmo stride), para que a carga seja só um mmap do arquivo.
+// Depois do payload vêm os blocos esparsos de fora da janela, como registros StoredTile.
+enum MapCellType : uint32_t {MAP_CELL_NIBBLE = 1};
+
+struct MapFileHeader {
+    char magic[4];          // "TP1M"
+    uint32_t version;
+    float inicio;
+    float fim;
+    float passo;
+    int32_t rows;
+    int32_t cols;
+    uint32_t cellType;      // MapCellType
+    uint64_t stride;        // bytes por linha no payload
+    uint64_t payloadBytes;
+    uint64_t checksum;      // FNV-1a de 64 bits, palavra a palavra, sobre o payload e os blocos
+    uint32_t sparseTiles;   // blocos esparsos depois do payload (0 em arquivos antigos)
+    uint8_t reserved[4];
+};
+static_assert(sizeof(MapFileHeader) == 64, "o payload precisa começar alinhado a 64 bytes");
+
+const uint32_t MAP_FILE_VERSION = 1;
+
+const uint64_t MAP_CHECKSUM_SEED = 14695981039346656037ull;
+
+// seed permite continuar o checksum de um bloco anterior
+uint64_t mapChecksum(const uint8_t* data, std::size_t bytes, uint64_t seed = MAP_CHECKSUM_SEED);
+
+// checksum, se não for nulo, recebe o checksum gravado no cabeçalho (usado pelo journal)
+bool saveMapFile(const NibbleGrid& map, const std::vector<StoredTile>& sparse, const std::string& fileName,
+                 uint64_t* checksum = nullptr);
+
+// Mapeia o arquivo em memória (MAP_PRIVATE) e faz a grade usar o payload sem cópia;
+// escritas posteriores na grade não alteram o arquivo. Os blocos esparsos são copiados para 'sparse'.
+bool loadMapFile(NibbleGrid& map, std::vector<StoredTile>& sparse, const std::string& fileName,
+                 uint64_t* checksum = nullptr);
+
+// Journal incremental: um arquivo só de acréscimos com os blocos (tiles) alterados desde o
+// último mapa completo. Cada checkpoint é um registro com cabeçalho, os blocos e um checksum;
+// um registro incompleto no fim (queda no meio da escrita) é simplesmente ignorado.
+struct MapJournalHeader {
+    char magic[4];          // "TP1J"
+    uint32_t version;
+    uint64_t baseChecksum;  // checksum do mapa completo sobre o qual o journal se aplica
+    int32_t rows;
+    int32_t cols;
+    int32_t tileSize;
+    uint8_t reserved[36];
+};
+static_assert(sizeof(MapJournalHeader) == 64, "cabeçalho do journal com 64 bytes");
+
+struct MapJournalRecord {
+    char magic[4];          // "TP1C"
+    uint32_t tiles;
+    uint64_t checksum;      // sobre os blocos (StoredTile) que seguem o registro
+};
+
+// Cria (ou trunca) o journal para um novo mapa base
+bool resetMapJournal(const std::string& fileName, const NibbleGrid& map, uint64_t baseChecksum);
+
+// Acrescenta um checkpoint com os blocos dados; retorna o tamanho do journal em bytes ou -1
+long appendMapJournal(const std::vector<StoredTile>& tiles, const std::string& fileName);
+
+// Aplica ao mapa os checkpoints válidos do journal: blocos dentro da grade vão para ela e os
+// demais substituem (ou se juntam a) 'sparse'. Retorna quantos checkpoints foram aplicados
+// ou -1 se o journal não corresponde ao mapa base.
+int replayMapJournal(NibbleGrid& map, std::vector<StoredTile>& sparse, uint64_t baseChecksum,
+                     const std::string& fileName);
+
+#endif // MAPFILE_HPP
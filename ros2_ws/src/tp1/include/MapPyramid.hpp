@@ -0,0 +1,70 @@
+// MapPyramid.hpp
+#ifndef MAPPYRAMID_HPP
+#define MAPPYRAMID_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "NibbleGrid.hpp"
+#include "OccupancyGrid.hpp"
+
+// Pirâmide de resoluções da janela densa: no nível k cada célula resume um bloco de 2^k x 2^k
+// células do mapa com o maior valor e a soma (para a média). O nível 0 é o próprio mapa.
+// Cada escrita atualiza um bloco por nível, O(log n); o máximo só é refeito a partir dos 4 filhos
+// quando o valor que saiu era o máximo do bloco.
+class MapPyramid {
+public:
+    // Guarda um ponteiro para a grade: ela precisa continuar viva enquanto a pirâmide for usada
+    void build(const NibbleGrid& grid);
+
+    // Solta a grade, sob o lock exclusivo, antes de ela ser trocada ou movida; até o próximo
+    // build() a pirâmide fica sem níveis
+    void detach();
+
+    // Chamado depois que a célula mudou de 'before' para 'after' na grade
+    void update(int linha, int coluna, int before, int after);
+
+    // Número de níveis acima do mapa (o último tem uma única célula)
+    int levels() const { return static_cast<int>(levels_.size()); }
+    int rows(int level) const;
+    int cols(int level) const;
+
+    int blockMax(int level, int linha, int coluna) const;
+    float blockMean(int level, int linha, int coluna) const;
+
+    // Alguma célula de [linha0, linha1) x [coluna0, coluna1) com valor acima de threshold?
+    // Desce do topo só pelos blocos cujo máximo passa do limiar.
+    bool anyAbove(int linha0, int coluna0, int linha1, int coluna1, int threshold) const;
+
+    // Chama visit(linha, coluna, maximo, media) para cada bloco do nível (1 a levels())
+    template <typename Visitor>
+    void forEachBlock(int level, Visitor&& visit) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (level < 1 || level > levels()) return;
+        const Level& lv = levels_[level - 1];
+        for (int l = 0; l < lv.max.rows(); ++l) {
+            for (int c = 0; c < lv.max.cols(); ++c) {
+                visit(l, c, static_cast<int>(lv.max(l, c)), mean(level, l, c));
+            }
+        }
+    }
+
+private:
+    struct Level {
+        OccupancyGrid<uint8_t> max;
+        OccupancyGrid<uint32_t> sum;
+    };
+
+    int maxAt(int level, int linha, int coluna) const;
+    float mean(int level, int linha, int coluna) const;
+    bool anyAbove(int level, int linha, int coluna,
+                  int linha0, int coluna0, int linha1, int coluna1, int threshold) const;
+
+    const NibbleGrid* grid_ = nullptr;
+    std::vector<Level> levels_;
+    mutable std::shared_mutex mutex_;
+};
+
+#endif // MAPPYRAMID_HPP
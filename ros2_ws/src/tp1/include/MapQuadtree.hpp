@@ -0,0 +1,84 @@
+// MapQuadtree.hpp
+#ifndef MAPQUADTREE_HPP
+#define MAPQUADTREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "NibbleGrid.hpp"
+
+// Quadtree sobre a janela densa do mapa: uma região em que todas as células têm o mesmo valor
+// vira uma única folha. Cada nó guarda o maior valor abaixo dele, então "há célula ocupada
+// nesta caixa?" desce só pelos ramos que podem responder sim.
+// Atualizada célula a célula pela thread de mapeamento (só quando o valor muda); as consultas
+// podem vir de outras threads.
+class MapQuadtree {
+public:
+    // A raiz cobre a menor potência de 2 que contém rows x cols; o que sobra fica com 'initial'
+    void build(const NibbleGrid& grid, int initial);
+
+    // Novo valor de uma célula: O(profundidade), dividindo ou juntando folhas no caminho
+    void update(int linha, int coluna, int value);
+
+    // Alguma célula de [linha0, linha1) x [coluna0, coluna1) com valor acima de threshold?
+    bool anyAbove(int linha0, int coluna0, int linha1, int coluna1, int threshold) const;
+
+    // Chama visit(linha, coluna, tamanho, valor) para cada folha (bloco uniforme) que começa dentro
+    // da grade; as folhas da borda podem passar dela
+    template <typename Visitor>
+    void forEachLeaf(Visitor&& visit) const { forEachLeafAbove(-1, visit); }
+
+    // Só as folhas com valor acima de threshold; ramos cujo máximo não passa dele nem são visitados
+    template <typename Visitor>
+    void forEachLeafAbove(int threshold, Visitor&& visit) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (!nodes_.empty()) visitLeaves(0, 0, 0, size_, threshold, visit);
+    }
+
+    std::size_t leafCount() const;
+    int size() const { return size_; }
+
+private:
+    struct Node {
+        int32_t firstChild;     // -1 nas folhas; os 4 filhos ficam em sequência
+        uint8_t value;          // valor da folha
+        uint8_t maxValue;       // maior valor da subárvore
+    };
+
+    int allocateChildren(uint8_t value);
+    void releaseChildren(int first);
+    void buildNode(int node, const NibbleGrid& grid, int linha, int coluna, int size);
+    void collapse(int node);
+    bool anyAbove(int node, int linha, int coluna, int size,
+                  int linha0, int coluna0, int linha1, int coluna1, int threshold) const;
+
+    template <typename Visitor>
+    void visitLeaves(int node, int linha, int coluna, int size, int threshold, Visitor& visit) const {
+        const Node& n = nodes_[node];
+        if (linha >= rows_ || coluna >= cols_ || n.maxValue <= threshold) return;
+
+        if (n.firstChild < 0) {
+            visit(linha, coluna, size, static_cast<int>(n.value));
+            return;
+        }
+
+        int half = size / 2;
+        visitLeaves(n.firstChild, linha, coluna, half, threshold, visit);
+        visitLeaves(n.firstChild + 1, linha, coluna + half, half, threshold, visit);
+        visitLeaves(n.firstChild + 2, linha + half, coluna, half, threshold, visit);
+        visitLeaves(n.firstChild + 3, linha + half, coluna + half, half, threshold, visit);
+    }
+
+    int rows_ = 0;
+    int cols_ = 0;
+    int size_ = 0;
+    int initial_ = 0;
+    std::vector<Node> nodes_;
+    std::vector<int> freeChildren_;
+    mutable std::shared_mutex mutex_;
+};
+
+#endif // MAPQUADTREE_HPP
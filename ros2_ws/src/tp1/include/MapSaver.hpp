@@ -0,0 +1,52 @@
+// MapSaver.hpp
+#ifndef MAPSAVER_HPP
+#define MAPSAVER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WorldMap.hpp"
+
+// Grava snapshots do mapa em uma thread própria: save() só pede o snapshot e retorna,
+// então quem chama (teclado, controle) nunca espera pela cópia nem pelo disco.
+// Depois do primeiro mapa completo, a cada autosavePeriod só os blocos alterados são
+// acrescentados ao journal; quando o journal passa do tamanho do mapa, ele é compactado
+// gravando um novo mapa completo.
+class MapSaver {
+public:
+    MapSaver(WorldMap& map, const std::string& mapName, const std::string& journalName,
+             std::chrono::milliseconds autosavePeriod);
+    ~MapSaver();
+
+    MapSaver(const MapSaver&) = delete;
+    MapSaver& operator=(const MapSaver&) = delete;
+
+    // Pede a gravação do mapa completo; retorna false se ainda houver uma gravação em andamento
+    bool save();
+
+private:
+    void run();
+    void writeSnapshot(bool full);
+
+    WorldMap& map_;
+    std::string mapName_;
+    std::string journalName_;
+    std::chrono::milliseconds autosavePeriod_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable pending_;
+    bool hasJob_ = false;
+    bool stop_ = false;
+
+    // Estado do par mapa + journal no disco (só a thread de gravação mexe)
+    bool hasBase_ = false;
+    long journalBytes_ = 0;
+    std::vector<StoredTile> journalTiles_;
+};
+
+#endif // MAPSAVER_HPP
@@ -2,12 +2,23 @@
 #ifndef MAPPING_HPP
 #define MAPPING_HPP
 
+#include <atomic>
 #include <cmath>
 #include <vector>
 #include <string>
 
+#include "OccupancyGrid.hpp"
+#include "WorldMap.hpp"
+#include "BitGrid.hpp"
+
 void* mappingThreadFunction(void* arg);
 
+enum MappingMode {MAP_HIMM, MAP_BAYES, MAP_LASER};
+extern std::atomic<MappingMode> mappingMode;
+
+// HIMM dos sonares dividido entre várias threads (mesmo resultado da versão serial)
+extern std::atomic<bool> parallelMapping;
+
 struct Position {
     float x, y, theta;
     bool isEqual(const Position& other, float epsilon = 1e-4f) const {
@@ -15,26 +26,11 @@ struct Position {
     }
 };
 
-struct GridInfo {
-    float inicio;
-    float fim;
-    float passo;
-};
-
-struct MatrixPosition {
-    int linha;
-    int coluna;
-};
-
-struct CellCenter {
-    float x;
-    float y;
-};
-
 struct Robot {
     MatrixPosition gridPos;
     Position pos;
     CellCenter cellCenter;
+    CellCenter mapPosition; // posição real do robô no mapa, sem arredondar para a célula
     double s;
     float beta = 10.0f; 
 };
@@ -51,7 +47,7 @@ struct CellInfo {
 };
 
 float round2(float valor);
-float bayes(float R, float r, float s, float beta, float alpha, float max, float pOcup);
+float bayesLogOdds(float R, float r, float s, float beta, float alpha, float max);
 int himm();
 
 void atualizaMatrizHIMM(
@@ -65,15 +61,9 @@ void atualizaMatrizHIMM(
     int maxValor = 15
 );
 void atualizaMatrizBayes(std::vector<std::vector<float>>& matriz, Robot robot, float sensorAngle);
-void salvaMatriz(const std::vector<std::vector<float>>& matriz, const std::string& nomeArquivo);
-std::vector<std::vector<float>> loadMatrix(const std::string& nomeArquivo);
 
 bool isValidPosition(const MatrixPosition& pos, int lines, int columns);
 
-MatrixPosition findCell(float x, float y, float inicio, float passo);
-
-CellCenter getCellCenter(const MatrixPosition& pos, float begin, float step);
-
 CellRelativeInfo getRelativeInfo(const CellCenter& botMiddle,const CellCenter& middlePoint,float botYaw);
 
 
@@ -0,0 +1,55 @@
+// Multigrid.hpp
+#ifndef MULTIGRID_HPP
+#define MULTIGRID_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "OccupancyGrid.hpp"
+#include "WorkerPool.hpp"
+
+// Solução da equação de Laplace por multigrid geométrico (V-ciclos), para o campo potencial
+// harmônico na grade inteira. As células marcadas em 'fixed' são condições de Dirichlet e
+// mantêm o valor; fora da grade o valor é 0.
+// Cada nível tem metade da resolução do anterior (cada célula grossa cobre 2x2 finas) e uma
+// borda extra de zeros, então o estêncil de 5 pontos não precisa testar limites.
+// Com um WorkerPool, as varreduras dos níveis grandes são divididas em faixas de linhas, uma por
+// thread (ver forEachBand).
+class LaplaceMultigrid {
+public:
+    explicit LaplaceMultigrid(WorkerPool* pool = nullptr) : pool_(pool) {}
+
+    // Parte do valor atual de 'field' e faz V-ciclos até o maior resíduo ficar abaixo de
+    // 'tolerance' ou até maxCycles. Retorna o número de V-ciclos.
+    int solve(OccupancyGrid<float>& field, const OccupancyGrid<uint8_t>& fixed, float tolerance, int maxCycles);
+
+    // Maior resíduo depois do último solve()
+    float residual() const { return residual_; }
+
+private:
+    struct Level {
+        int rows, cols;
+        OccupancyGrid<float> value;    // solução (nível 0) ou correção (demais)
+        OccupancyGrid<float> rhs;
+        OccupancyGrid<float> residual;
+        OccupancyGrid<uint8_t> fixed;
+    };
+
+    void build(const OccupancyGrid<float>& field, const OccupancyGrid<uint8_t>& fixed);
+    void cycle(int level);
+    void smooth(Level& level, int sweeps);
+    float computeResidual(Level& level);
+    void restrict(const Level& fine, Level& coarse);
+    void prolong(const Level& coarse, Level& fine);
+
+    int bands(int rows) const;
+    void forEachBand(int rows, const std::function<void(int, int, int)>& band);
+
+    WorkerPool* pool_;
+    std::vector<Level> levels_;
+    std::vector<float> partial_;    // resultado parcial de cada faixa
+    float residual_ = 0.0f;
+};
+
+#endif // MULTIGRID_HPP
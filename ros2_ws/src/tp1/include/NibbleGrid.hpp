@@ -0,0 +1,133 @@
+// NibbleGrid.hpp
+#ifndef NIBBLEGRID_HPP
+#define NIBBLEGRID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "OccupancyGrid.hpp"
+
+// Grade HIMM compactada: cada célula guarda um valor de 0 a 15 em 4 bits, duas por byte.
+// A coluna par fica no nibble baixo e a ímpar no alto; os bytes seguem o Layout da OccupancyGrid
+// (NibbleGrid é a versão row-major, a única com acesso por linha e usada nos arquivos de mapa).
+template <typename Layout = RowMajorLayout>
+class BasicNibbleGrid {
+public:
+    static constexpr int MAX_VALUE = 15;
+
+    BasicNibbleGrid() = default;
+
+    BasicNibbleGrid(const GridInfo& info, int initial) { reset(info, initial); }
+
+    BasicNibbleGrid(int rows, int cols, const GridInfo& info, int initial) { reset(rows, cols, info, initial); }
+
+    void reset(const GridInfo& info, int initial) {
+        int cells = static_cast<int>((info.fim - info.inicio) / info.passo);
+        reset(cells, cells, info, initial);
+    }
+
+    void reset(int rows, int cols, const GridInfo& info, int initial) {
+        cols_ = cols;
+        bytes_.reset(rows, (cols + 1) / 2, info, 0);
+        fill(initial);
+    }
+
+    // Usa diretamente um bloco de bytes compactados já preenchido (ver OccupancyGrid::adopt)
+    void adopt(uint8_t* data, int rows, int cols, std::ptrdiff_t stride, const GridInfo& info,
+               void* base, std::size_t length, void (*release)(void*, std::size_t)) {
+        cols_ = cols;
+        bytes_.adopt(data, rows, (cols + 1) / 2, stride, info, base, length, release);
+    }
+
+    void fill(int value) {
+        uint8_t nibble = saturate(value);
+        bytes_.fill(static_cast<uint8_t>(nibble | (nibble << 4)));
+    }
+
+    int get(int linha, int coluna) const {
+        return (bytes_(linha, coluna >> 1) >> shift(coluna)) & 0x0F;
+    }
+
+    int get(const MatrixPosition& pos) const { return get(pos.linha, pos.coluna); }
+
+    // Grava o valor já saturado em [0, 15]
+    void set(int linha, int coluna, int value) {
+        uint8_t& byte = bytes_(linha, coluna >> 1);
+        int s = shift(coluna);
+        byte = static_cast<uint8_t>((byte & ~(0x0F << s)) | (saturate(value) << s));
+    }
+
+    void set(const MatrixPosition& pos, int value) { set(pos.linha, pos.coluna, value); }
+
+    void increment(const MatrixPosition& pos, int amount) { set(pos, get(pos) + amount); }
+
+    void decrement(const MatrixPosition& pos, int amount) { set(pos, get(pos) - amount); }
+
+    // Limita a [0, 15] sem desvios: zera negativos pelo sinal e troca por 15 o que passar do máximo
+    static uint8_t saturate(int value) {
+        value &= ~(value >> 31);
+        int over = (MAX_VALUE - value) >> 31;
+        return static_cast<uint8_t>((value & ~over) | (MAX_VALUE & over));
+    }
+
+    int rows() const { return bytes_.rows(); }
+    int cols() const { return cols_; }
+    bool empty() const { return bytes_.empty(); }
+    const GridInfo& info() const { return bytes_.info(); }
+
+    // Acesso direto aos bytes compactados, linha a linha
+    uint8_t* row(int linha) { return bytes_.row(linha); }
+    const uint8_t* row(int linha) const { return bytes_.row(linha); }
+    uint8_t* data() { return bytes_.data(); }
+    const uint8_t* data() const { return bytes_.data(); }
+    std::ptrdiff_t stride() const { return bytes_.stride(); }
+    std::size_t bytes() const { return bytes_.bytes(); }
+
+    bool isValid(const MatrixPosition& pos) const {
+        return pos.linha >= 0 && pos.linha < rows() && pos.coluna >= 0 && pos.coluna < cols_;
+    }
+
+    MatrixPosition findCell(float x, float y) const { return bytes_.findCell(x, y); }
+
+    CellCenter getCellCenter(const MatrixPosition& pos) const { return bytes_.getCellCenter(pos); }
+
+private:
+    static int shift(int coluna) { return (coluna & 1) << 2; }
+
+    int cols_ = 0;
+    OccupancyGrid<uint8_t, Layout> bytes_;
+};
+
+using NibbleGrid = BasicNibbleGrid<>;
+
+// Bloco de SIZE x SIZE células no mesmo formato compactado da NibbleGrid
+struct NibbleTile {
+    static constexpr int SIZE = 32;
+
+    uint8_t bytes[SIZE][SIZE / 2];
+
+    int get(int linha, int coluna) const {
+        return (bytes[linha][coluna >> 1] >> ((coluna & 1) << 2)) & 0x0F;
+    }
+
+    void set(int linha, int coluna, int value) {
+        uint8_t& byte = bytes[linha][coluna >> 1];
+        int s = (coluna & 1) << 2;
+        byte = static_cast<uint8_t>((byte & ~(0x0F << s)) | (NibbleGrid::saturate(value) << s));
+    }
+
+    void fill(int value) {
+        uint8_t nibble = NibbleGrid::saturate(value);
+        std::memset(bytes, nibble | (nibble << 4), sizeof(bytes));
+    }
+};
+
+// Bloco acompanhado da sua posição (em blocos); é também o registro gravado nos arquivos de mapa
+struct StoredTile {
+    MatrixPosition tile;
+    NibbleTile cells;
+};
+static_assert(sizeof(StoredTile) == 8 + sizeof(NibbleTile), "StoredTile é gravado diretamente em disco");
+
+#endif // NIBBLEGRID_HPP
@@ -0,0 +1,258 @@
+// OccupancyGrid.hpp
+#ifndef OCCUPANCYGRID_HPP
+#define OCCUPANCYGRID_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+struct GridInfo {
+    float inicio;
+    float fim;
+    float passo;
+};
+
+struct MatrixPosition {
+    int linha;
+    int coluna;
+};
+
+struct CellCenter {
+    float x;
+    float y;
+};
+
+MatrixPosition findCell(float x, float y, float inicio, float passo);
+
+CellCenter getCellCenter(const MatrixPosition& pos, float begin, float step);
+
+// Janela retangular sobre uma grade contígua; as linhas ficam a 'stride' elementos uma da outra
+template <typename T>
+class GridView {
+public:
+    GridView(T* data, int rows, int cols, std::ptrdiff_t stride)
+        : data_(data), rows_(rows), cols_(cols), stride_(stride) {}
+
+    T& operator()(int linha, int coluna) const { return data_[linha * stride_ + coluna]; }
+    T* row(int linha) const { return data_ + linha * stride_; }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::ptrdiff_t stride() const { return stride_; }
+
+    GridView subView(int linha, int coluna, int rows, int cols) const {
+        return GridView(row(linha) + coluna, rows, cols, stride_);
+    }
+
+private:
+    T* data_;
+    int rows_;
+    int cols_;
+    std::ptrdiff_t stride_;
+};
+
+// Layouts de memória da grade, escolhidos em tempo de compilação (sem custo de despacho).
+// Cada um diz, a partir do stride, quantos elementos alocar e onde fica cada célula.
+
+// Linha a linha; o stride é o número de colunas arredondado para um múltiplo de 64 bytes
+struct RowMajorLayout {
+    static constexpr bool ROWS_CONTIGUOUS = true;
+
+    static std::ptrdiff_t stride(int cols, std::size_t elementSize) {
+        if (64 % elementSize != 0) return cols;
+        std::ptrdiff_t perLine = 64 / elementSize;
+        return (cols + perLine - 1) / perLine * perLine;
+    }
+
+    static std::size_t elements(int rows, std::ptrdiff_t stride) { return static_cast<std::size_t>(rows) * stride; }
+
+    static std::size_t index(int linha, int coluna, std::ptrdiff_t stride) {
+        return static_cast<std::size_t>(linha) * stride + coluna;
+    }
+};
+
+// Blocos de 2^LOG2 x 2^LOG2 células guardados em sequência, com os blocos em ordem de linha;
+// o stride é o número de blocos por linha. Raios quase verticais e a vizinhança 3x3 ficam
+// dentro de poucos blocos em vez de espalhados por várias linhas da grade.
+template <int LOG2 = 3>
+struct TiledLayout {
+    static constexpr bool ROWS_CONTIGUOUS = false;
+    static constexpr int SIDE = 1 << LOG2;
+    static constexpr int MASK = SIDE - 1;
+
+    static std::ptrdiff_t stride(int cols, std::size_t) { return (cols + MASK) >> LOG2; }
+
+    static std::size_t elements(int rows, std::ptrdiff_t stride) {
+        return static_cast<std::size_t>((rows + MASK) >> LOG2) * stride << (2 * LOG2);
+    }
+
+    static std::size_t index(int linha, int coluna, std::ptrdiff_t stride) {
+        std::size_t tile = static_cast<std::size_t>(linha >> LOG2) * stride + (coluna >> LOG2);
+        return (tile << (2 * LOG2)) + ((linha & MASK) << LOG2) + (coluna & MASK);
+    }
+};
+
+// Como TiledLayout, mas dentro do bloco as células seguem a curva Z (Morton): os bits de linha e
+// coluna são intercalados, então vizinhas em qualquer direção tendem a ficar próximas
+template <int LOG2 = 3>
+struct MortonLayout {
+    static_assert(LOG2 <= 4, "blocos Morton de até 16x16");
+
+    static constexpr bool ROWS_CONTIGUOUS = false;
+    static constexpr int MASK = (1 << LOG2) - 1;
+
+    static std::ptrdiff_t stride(int cols, std::size_t size) { return TiledLayout<LOG2>::stride(cols, size); }
+
+    static std::size_t elements(int rows, std::ptrdiff_t stride) { return TiledLayout<LOG2>::elements(rows, stride); }
+
+    // Espalha 4 bits nas posições pares: abcd -> 0a0b0c0d
+    static unsigned spread(unsigned x) {
+        x = (x | (x << 2)) & 0x33u;
+        return (x | (x << 1)) & 0x55u;
+    }
+
+    static std::size_t index(int linha, int coluna, std::ptrdiff_t stride) {
+        std::size_t tile = static_cast<std::size_t>(linha >> LOG2) * stride + (coluna >> LOG2);
+        return (tile << (2 * LOG2)) + ((spread(linha & MASK) << 1) | spread(coluna & MASK));
+    }
+};
+
+// Grade em um único bloco alinhado a 64 bytes (uma linha de cache), no layout dado por Layout.
+// No padrão (row-major) cada linha é preenchida até um múltiplo de 64 bytes, então toda linha
+// começa alinhada; row(), view() e adopt() só existem nesse layout.
+template <typename T, typename Layout = RowMajorLayout>
+class OccupancyGrid {
+    static_assert(std::is_trivially_copyable<T>::value, "OccupancyGrid exige celulas trivialmente copiaveis");
+
+public:
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    OccupancyGrid() = default;
+
+    OccupancyGrid(const GridInfo& info, T initial) { reset(info, initial); }
+
+    OccupancyGrid(int rows, int cols, const GridInfo& info, T initial) { reset(rows, cols, info, initial); }
+
+    OccupancyGrid(const OccupancyGrid& other)
+        : info_(other.info_), rows_(other.rows_), cols_(other.cols_), stride_(other.stride_),
+          data_(allocate(other.rows_, other.stride_)) {
+        if (data_) std::memcpy(data_.get(), other.data_.get(), bytes());
+    }
+
+    OccupancyGrid& operator=(const OccupancyGrid& other) {
+        if (this != &other) {
+            if (rows_ != other.rows_ || stride_ != other.stride_) {
+                data_ = allocate(other.rows_, other.stride_);
+            }
+            info_ = other.info_;
+            rows_ = other.rows_;
+            cols_ = other.cols_;
+            stride_ = other.stride_;
+            if (data_) std::memcpy(data_.get(), other.data_.get(), bytes());
+        }
+        return *this;
+    }
+
+    OccupancyGrid(OccupancyGrid&&) noexcept = default;
+    OccupancyGrid& operator=(OccupancyGrid&&) noexcept = default;
+
+    // Passa a usar um bloco externo já preenchido (por exemplo um arquivo mapeado em memória).
+    // release(base, length) é chamado quando a grade deixa de usá-lo.
+    void adopt(T* data, int rows, int cols, std::ptrdiff_t stride, const GridInfo& info,
+               void* base, std::size_t length, void (*release)(void*, std::size_t)) {
+        requireRows();
+        info_ = info;
+        rows_ = rows;
+        cols_ = cols;
+        stride_ = stride;
+        data_ = Buffer(data, Release{base, length, release});
+    }
+
+    void reset(const GridInfo& info, T initial) {
+        int cells = static_cast<int>((info.fim - info.inicio) / info.passo);
+        reset(cells, cells, info, initial);
+    }
+
+    void reset(int rows, int cols, const GridInfo& info, T initial) {
+        info_ = info;
+        rows_ = rows;
+        cols_ = cols;
+        stride_ = Layout::stride(cols, sizeof(T));
+        data_ = allocate(rows_, stride_);
+        fill(initial);
+    }
+
+    void fill(T value) {
+        std::fill(data_.get(), data_.get() + Layout::elements(rows_, stride_), value);
+    }
+
+    T& operator()(int linha, int coluna) { return data_[Layout::index(linha, coluna, stride_)]; }
+    const T& operator()(int linha, int coluna) const { return data_[Layout::index(linha, coluna, stride_)]; }
+
+    T& operator[](const MatrixPosition& pos) { return (*this)(pos.linha, pos.coluna); }
+    const T& operator[](const MatrixPosition& pos) const { return (*this)(pos.linha, pos.coluna); }
+
+    T* row(int linha) { requireRows(); return data_.get() + linha * stride_; }
+    const T* row(int linha) const { requireRows(); return data_.get() + linha * stride_; }
+
+    T* data() { return data_.get(); }
+    const T* data() const { return data_.get(); }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::ptrdiff_t stride() const { return stride_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    std::size_t bytes() const { return Layout::elements(rows_, stride_) * sizeof(T); }
+    const GridInfo& info() const { return info_; }
+
+    bool isValid(const MatrixPosition& pos) const {
+        return pos.linha >= 0 && pos.linha < rows_ && pos.coluna >= 0 && pos.coluna < cols_;
+    }
+
+    MatrixPosition findCell(float x, float y) const { return ::findCell(x, y, info_.inicio, info_.passo); }
+
+    CellCenter getCellCenter(const MatrixPosition& pos) const { return ::getCellCenter(pos, info_.inicio, info_.passo); }
+
+    GridView<T> view() { requireRows(); return GridView<T>(data_.get(), rows_, cols_, stride_); }
+    GridView<const T> view() const { requireRows(); return GridView<const T>(data_.get(), rows_, cols_, stride_); }
+
+    GridView<T> view(int linha, int coluna, int rows, int cols) { return view().subView(linha, coluna, rows, cols); }
+    GridView<const T> view(int linha, int coluna, int rows, int cols) const { return view().subView(linha, coluna, rows, cols); }
+
+private:
+    static void requireRows() {
+        static_assert(Layout::ROWS_CONTIGUOUS, "acesso por linha só no layout row-major");
+    }
+
+    static void freeAligned(void* base, std::size_t) { std::free(base); }
+
+    struct Release {
+        void* base = nullptr;
+        std::size_t length = 0;
+        void (*release)(void*, std::size_t) = freeAligned;
+
+        void operator()(T* ptr) const { release(base ? base : ptr, length); }
+    };
+    using Buffer = std::unique_ptr<T[], Release>;
+
+    static Buffer allocate(int rows, std::ptrdiff_t stride) {
+        std::size_t size = Layout::elements(rows, stride) * sizeof(T);
+        if (size == 0) return Buffer();
+        size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        void* ptr = std::aligned_alloc(ALIGNMENT, size);
+        if (!ptr) throw std::bad_alloc();
+        return Buffer(static_cast<T*>(ptr));
+    }
+
+    GridInfo info_ = {0.0f, 0.0f, 1.0f};
+    int rows_ = 0;
+    int cols_ = 0;
+    std::ptrdiff_t stride_ = 0;
+    Buffer data_;
+};
+
+#endif // OCCUPANCYGRID_HPP
@@ -5,6 +5,8 @@
 #include <sensor_msgs/msg/laser_scan.hpp>
 #include <nav_msgs/msg/odometry.hpp>
 
+#include "PoseHistory.hpp"
+
 class Perception
 {
     public:
@@ -13,6 +15,18 @@ class Perception
         std::vector<float> getLatestLaserRanges();
         std::vector<float> getLatestSonarRanges();
         std::vector<float> getLatestPose();
+
+        // Número de mensagens de sonar / laser recebidas; muda a cada leitura nova do sensor
+        uint32_t getSonarSequence();
+        uint32_t getLaserSequence();
+
+        // Instante (s) do cabeçalho da última leitura de sonar / laser
+        double getLatestSonarStamp();
+        double getLatestLaserStamp();
+
+        // Pose {x, y, yaw} da odometria no instante 'stamp', interpolada pelo histórico;
+        // vazio se nenhuma pose chegou ainda
+        std::vector<float> getPoseAt(double stamp);
         
         void receiveLaser(const sensor_msgs::msg::LaserScan::ConstSharedPtr &value);
         void receiveSonar(const sensor_msgs::msg::PointCloud2::ConstSharedPtr &value);
@@ -22,6 +36,9 @@ class Perception
         sensor_msgs::msg::LaserScan laserROS;
         sensor_msgs::msg::PointCloud2 sonarROS;
         nav_msgs::msg::Odometry poseROS;
+        uint32_t sonarSequence = 0;
+        uint32_t laserSequence = 0;
+        PoseHistory poseHistory;
 
 };
 
@@ -0,0 +1,66 @@
+// PoseHistory.hpp
+#ifndef POSEHISTORY_HPP
+#define POSEHISTORY_HPP
+
+#include <cmath>
+
+// Pose da odometria em um instante (segundos do cabeçalho da mensagem)
+struct StampedPose {
+    double stamp;
+    float x, y, theta;
+};
+
+// Buffer circular com as últimas CAPACITY poses da odometria, em ordem de chegada. Serve para
+// achar a pose do robô no instante em que cada sensor fez a leitura, e não no instante em que
+// a leitura é processada.
+class PoseHistory {
+public:
+    static constexpr int CAPACITY = 64;
+
+    void push(const StampedPose& pose) {
+        // Mensagem fora de ordem ou repetida: o buffer precisa ficar ordenado por instante
+        if (count_ > 0 && pose.stamp <= nth(count_ - 1).stamp) return;
+
+        poses_[(first_ + count_) % CAPACITY] = pose;
+        if (count_ < CAPACITY) ++count_;
+        else first_ = (first_ + 1) % CAPACITY;
+    }
+
+    bool empty() const { return count_ == 0; }
+
+    const StampedPose& latest() const { return nth(count_ - 1); }
+
+    // Pose no instante 'stamp', interpolada entre as duas vizinhas (o ângulo pelo menor arco).
+    // Fora do intervalo guardado devolve a pose mais próxima, sem extrapolar. Exige !empty().
+    StampedPose at(double stamp) const {
+        if (stamp <= nth(0).stamp) return nth(0);
+        if (stamp >= latest().stamp) return latest();
+
+        // Busca binária pela primeira pose depois de 'stamp'
+        int low = 1, high = count_ - 1;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (nth(middle).stamp <= stamp) low = middle + 1;
+            else high = middle;
+        }
+
+        const StampedPose& before = nth(low - 1);
+        const StampedPose& after = nth(low);
+        float t = static_cast<float>((stamp - before.stamp) / (after.stamp - before.stamp));
+        float turn = std::remainder(after.theta - before.theta, 2.0f * static_cast<float>(M_PI));
+
+        return {stamp,
+                before.x + t * (after.x - before.x),
+                before.y + t * (after.y - before.y),
+                std::remainder(before.theta + t * turn, 2.0f * static_cast<float>(M_PI))};
+    }
+
+private:
+    const StampedPose& nth(int i) const { return poses_[(first_ + i) % CAPACITY]; }
+
+    StampedPose poses_[CAPACITY];
+    int first_ = 0;
+    int count_ = 0;
+};
+
+#endif // POSEHISTORY_HPP
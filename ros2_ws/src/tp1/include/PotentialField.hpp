@@ -2,6 +2,15 @@
 #ifndef POTENTIALFIELD_HPP
 #define POTENTIALFIELD_HPP
 
+#include <atomic>
+
 void* potentialFieldThreadFunction(void* arg);
 
+// Resolve o campo na grade inteira por multigrid (padrão); desligado, usa SOR só em volta do robô
+extern std::atomic<bool> fullFieldSolve;
+
+// Fator de sobre-relaxação da solução do campo, em (0, 2); 0 escolhe o ótimo para a janela.
+// A tecla 'o' percorre 1.0, 1.1, ..., 1.9 e volta ao ótimo.
+extern std::atomic<float> sorOmega;
+
 #endif // POTENTIALFIELD_HPP
\ No newline at end of file
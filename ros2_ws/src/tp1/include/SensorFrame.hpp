@@ -0,0 +1,86 @@
+// SensorFrame.hpp
+#ifndef SENSORFRAME_HPP
+#define SENSORFRAME_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Mapping.hpp"
+
+// Leituras de um ciclo de controle. Cada sensor vem com a pose da odometria no instante do seu
+// cabeçalho, para os raios partirem de onde o robô estava quando a leitura foi feita.
+struct SensorFrame {
+    uint32_t sonarSequence = 0;  // Perception::getSonarSequence(); só muda com leitura nova de sonar
+    uint32_t laserSequence = 0;  // Perception::getLaserSequence(); só muda com leitura nova de laser
+    Position pose = {0.0f, 0.0f, 0.0f};  // pose mais recente (controle, desenho, campo potencial)
+    double sonarStamp = 0.0;  // segundos
+    Position sonarPose = {0.0f, 0.0f, 0.0f};
+    double laserStamp = 0.0;
+    Position laserPose = {0.0f, 0.0f, 0.0f};
+    std::vector<float> sonars;
+    std::vector<float> lasers;
+};
+
+// Buffer triplo com um produtor e um consumidor: o produtor escreve em back() e publica, o
+// consumidor pega o mais recente com update(). Cada lado só troca um índice atômico, então
+// nenhum dos dois espera pelo outro e o consumidor nunca vê um valor pela metade.
+template <typename T>
+class TripleBuffer {
+public:
+    T& back() { return slots_[back_]; }
+
+    void publish() {
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Passa para o valor mais recente; false se nada foi publicado desde a última troca
+    bool update() {
+        if (!(middle_.load(std::memory_order_acquire) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T slots_[3];
+    int back_ = 0;
+    int front_ = 1;
+    std::atomic<int> middle_{2};
+};
+
+// Distribui os quadros do laço de controle para as threads que os leem, com um buffer triplo
+// por leitor. Os vetores de cada posição são reaproveitados, então depois dos primeiros quadros
+// publicar não aloca memória.
+class SensorFeed {
+public:
+    enum Reader { MAPPING, FIELD, GRAPHICS, READERS };
+
+    SensorFeed();
+    ~SensorFeed();
+
+    SensorFeed(const SensorFeed&) = delete;
+    SensorFeed& operator=(const SensorFeed&) = delete;
+
+    // Só o laço de controle publica
+    void publish(const SensorFrame& frame);
+
+    // Quadro mais recente para este leitor (o anterior se nada novo chegou); só a thread do leitor chama
+    const SensorFrame& latest(Reader reader) {
+        buffers_[reader].update();
+        return buffers_[reader].front();
+    }
+
+    // Espera até timeoutMs por um quadro novo para o leitor; false se o tempo acabou
+    bool wait(Reader reader, int timeoutMs);
+
+private:
+    TripleBuffer<SensorFrame> buffers_[READERS];
+    int events_[READERS];  // eventfd de cada leitor, para wait()
+};
+
+#endif // SENSORFRAME_HPP
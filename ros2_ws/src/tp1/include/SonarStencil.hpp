@@ -0,0 +1,37 @@
+// SonarStencil.hpp
+#ifndef SONARSTENCIL_HPP
+#define SONARSTENCIL_HPP
+
+#include <vector>
+
+// Célula coberta pelo cone de um sonar, relativa à célula do robô
+struct StencilCell {
+    int dLinha;
+    int dColuna;
+    float distancia;
+    float anguloRelativo; // em graus, em relação ao eixo do feixe
+};
+
+// Cache de cones de sonar pré-calculados, indexado pelo ângulo global do feixe quantizado.
+// Como alcance, abertura e passo da grade são fixos, o conjunto de células coberto depende
+// só da direção do feixe; cada cone é calculado uma vez e fica ordenado por distância.
+class SonarStencilCache {
+public:
+    explicit SonarStencilCache(int bins = 720);
+
+    // Descarta os cones já calculados se algum parâmetro mudou
+    void configure(float range, float beta, float step);
+
+    const std::vector<StencilCell>& get(float globalAngle);
+
+private:
+    void build(int bin);
+
+    float range_;
+    float beta_;
+    float step_;
+    std::vector<std::vector<StencilCell>> stencils_;
+    std::vector<bool> built_;
+};
+
+#endif // SONARSTENCIL_HPP
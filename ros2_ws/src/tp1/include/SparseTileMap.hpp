@@ -0,0 +1,97 @@
+// SparseTileMap.hpp
+#ifndef SPARSETILEMAP_HPP
+#define SPARSETILEMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "OccupancyGrid.hpp"
+
+// Blocos alocados sob demanda e indexados por hash das suas coordenadas (em blocos, podendo ser
+// negativas). Cada bloco tem endereço fixo, então o último acessado pelas buscas não const fica
+// em cache: raios consecutivos quase sempre caem no mesmo bloco e nem chegam a consultar a tabela.
+// A busca const não mexe no cache, então pode ser feita por outras threads enquanto ninguém escreve.
+template <typename Tile>
+class SparseTileMap {
+public:
+    SparseTileMap() = default;
+    SparseTileMap(const SparseTileMap&) = delete;
+    SparseTileMap& operator=(const SparseTileMap&) = delete;
+
+    const Tile* find(int linha, int coluna) const {
+        auto it = tiles_.find(key(linha, coluna));
+        return it == tiles_.end() ? nullptr : it->second.get();
+    }
+
+    Tile* find(int linha, int coluna) {
+        uint64_t k = key(linha, coluna);
+        if (last_ && lastKey_ == k) return last_;
+
+        auto it = tiles_.find(k);
+        if (it == tiles_.end()) return nullptr;
+        lastKey_ = k;
+        last_ = it->second.get();
+        return last_;
+    }
+
+    // Retorna o bloco, criando-o como cópia de 'initial' se ainda não existir
+    Tile& obtain(int linha, int coluna, const Tile& initial) {
+        if (Tile* tile = find(linha, coluna)) return *tile;
+
+        uint64_t k = key(linha, coluna);
+        std::unique_ptr<Tile>& slot = tiles_[k];
+        slot.reset(new Tile(initial));
+        lastKey_ = k;
+        last_ = slot.get();
+        return *last_;
+    }
+
+    // Chama visit(posicaoDoBloco, bloco) para cada bloco alocado, sem ordem definida
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        for (const auto& entry : tiles_) {
+            visit(position(entry.first), static_cast<const Tile&>(*entry.second));
+        }
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor&& visit) {
+        for (auto& entry : tiles_) visit(position(entry.first), *entry.second);
+    }
+
+    void clear() {
+        tiles_.clear();
+        last_ = nullptr;
+    }
+
+    std::size_t size() const { return tiles_.size(); }
+    bool empty() const { return tiles_.empty(); }
+
+private:
+    static uint64_t key(int linha, int coluna) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(linha)) << 32) | static_cast<uint32_t>(coluna);
+    }
+
+    static MatrixPosition position(uint64_t k) {
+        return {static_cast<int32_t>(k >> 32), static_cast<int32_t>(k & 0xFFFFFFFFu)};
+    }
+
+    // Mistura os bits (splitmix64) para linhas e colunas vizinhas não caírem nos mesmos baldes
+    struct Hash {
+        std::size_t operator()(uint64_t k) const {
+            k ^= k >> 30;
+            k *= 0xbf58476d1ce4e5b9ull;
+            k ^= k >> 27;
+            k *= 0x94d049bb133111ebull;
+            return static_cast<std::size_t>(k ^ (k >> 31));
+        }
+    };
+
+    std::unordered_map<uint64_t, std::unique_ptr<Tile>, Hash> tiles_;
+    uint64_t lastKey_ = 0;
+    Tile* last_ = nullptr;
+};
+
+#endif // SPARSETILEMAP_HPP
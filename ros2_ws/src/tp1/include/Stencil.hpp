@@ -0,0 +1,40 @@
+// Stencil.hpp
+#ifndef STENCIL_HPP
+#define STENCIL_HPP
+
+#include <cstdint>
+
+// Núcleos do estêncil de 5 pontos das varreduras do campo potencial, uma linha por chamada.
+// 'up' e 'down' são as linhas vizinhas e as células x - 1 e x + 1 são lidas da própria linha,
+// então [begin, end) não pode encostar na borda da grade. As funções "Row" de cor vermelho-preto
+// só mexem nas células com (x & 1) == parity.
+// Há versões AVX2, SSE4.1 e escalar que dão exatamente os mesmos valores nas células (só a soma
+// do erro muda de ordem); stencilKernels() escolhe em tempo de execução a melhor que o
+// processador suporta.
+enum StencilIsa {STENCIL_SCALAR, STENCIL_SSE41, STENCIL_AVX2};
+
+struct StencilKernels {
+    const char* name;
+
+    // SOR do campo, sem mexer nas células que valem 1 (obstáculos).
+    // Retorna a soma dos quadrados das correções de Gauss-Seidel.
+    float (*sorRow)(float* row, const float* up, const float* down, int begin, int end, int parity, float omega);
+
+    // Gauss-Seidel de 4u - vizinhos = rhs nas células com fixed == 0
+    void (*smoothRow)(float* u, const float* up, const float* down, const float* rhs,
+                      const uint8_t* fixed, int begin, int end, int parity);
+
+    // Resíduo rhs + vizinhos - 4u em todas as células (0 nas fixas). Retorna o maior em módulo.
+    float (*residualRow)(float* residual, const float* u, const float* up, const float* down,
+                         const float* rhs, const uint8_t* fixed, int begin, int end);
+};
+
+bool stencilSupported(StencilIsa isa);
+
+// Núcleos de um nível específico (o escalar se o processador não suportar)
+const StencilKernels& stencilKernels(StencilIsa isa);
+
+// Núcleos do melhor nível suportado, escolhido na primeira chamada
+const StencilKernels& stencilKernels();
+
+#endif // STENCIL_HPP
@@ -0,0 +1,64 @@
+// WorkerPool.hpp
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads fixas para dividir um laço em tarefas independentes. Em run() cada thread, inclusive a
+// que chamou, pega a próxima tarefa livre de um contador atômico até acabarem, então quem
+// termina antes rouba o trabalho restante das outras.
+class WorkerPool {
+public:
+    // 'threads' é o total de threads trabalhando, contando a que chama run()
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int workers() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // Faixas com menos linhas que isso só pagariam a barreira entre as meias varreduras
+    static constexpr int MIN_BAND_ROWS = 4;
+
+    // Executa task(tarefa, worker) para tarefa em [0, count) e só retorna quando todas terminarem.
+    // 'worker' fica em [0, workers()) e serve para indexar dados de cada thread.
+    void run(int count, const std::function<void(int, int)>& task);
+
+    // Número de faixas em que runBands() divide 'rows' linhas: uma por thread, mas nenhuma com
+    // menos de minRows linhas (grades pequenas ficam numa faixa só, sem acordar ninguém)
+    int bands(int rows, int minRows) const;
+
+    // Piso de linhas por faixa que divide 'rows' entre todas as threads: rows / workers(), mas
+    // nunca menos que MIN_BAND_ROWS
+    int bandRows(int rows) const { return std::max(MIN_BAND_ROWS, rows / workers()); }
+
+    // Divide [0, rows) em bands(rows, minRows) faixas contíguas e executa band(início, fim, faixa)
+    // com uma faixa por thread. O índice da faixa não depende de qual thread a pegou, então serve
+    // para acumular resultados parciais que somam sempre na mesma ordem.
+    void runBands(int rows, int minRows, const std::function<void(int, int, int)>& band);
+
+private:
+    void work(int worker);
+    void drain(int worker);
+
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable started_;
+    std::condition_variable finished_;
+    const std::function<void(int, int)>* task_ = nullptr;
+    int count_ = 0;
+    int running_ = 0;
+    unsigned long generation_ = 0;
+    bool stop_ = false;
+    std::atomic<int> next_{0};
+};
+
+#endif // WORKERPOOL_HPP
@@ -0,0 +1,254 @@
+// WorldMap.hpp
+#ifndef WORLDMAP_HPP
+#define WORLDMAP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "MapPyramid.hpp"
+#include "NibbleGrid.hpp"
+#include "SparseTileMap.hpp"
+#include "WorkerPool.hpp"
+
+// Mapa HIMM do mundo. A janela dada por GridInfo (arredondada para blocos inteiros) fica numa
+// grade densa; fora dela o mapa não tem limite e é guardado em blocos esparsos, alocados só onde
+// o robô de fato sensoriou.
+// Toda escrita passa por aqui para que o mapa possa tirar snapshots consistentes sem parar a
+// thread de mapeamento: a janela é dividida em blocos de TILE x TILE células e, durante um
+// snapshot, cada bloco é copiado uma única vez antes de ser alterado (copy-on-write). O que a
+// thread de mapeamento não alterar é copiado pela thread de gravação.
+// Os blocos escritos desde o último snapshot ficam marcados como sujos, para o journal.
+// Opcionalmente a janela é espelhada numa pirâmide de resoluções, mantida a cada célula que
+// muda de valor.
+// As outras threads leem a janela por view(): versões imutáveis publicadas pela thread de
+// mapeamento, no estilo RCU. Quem segura uma versão nunca trava o mapeamento e a memória dela só
+// é reaproveitada depois que o último leitor a solta.
+class WorldMap {
+public:
+    // Cópia da janela densa em um instante entre duas leituras de sensores.
+    // tileVersion[bloco] é a versão em que cada bloco (linha * tileColumns() + coluna) mudou por
+    // último: um leitor que guarda a versão que já processou sabe quais blocos mudaram desde então.
+    // Com WITH_PYRAMID, tileMax[bloco] é o maior valor do bloco (consulta grossa: um bloco com
+    // máximo baixo não tem obstáculo); sem a pirâmide fica vazio.
+    struct MapView {
+        uint64_t version;
+        NibbleGrid cells;
+        std::vector<uint64_t> tileVersion;
+        std::vector<uint8_t> tileMax;
+    };
+
+    static constexpr int TILE = NibbleTile::SIZE;
+    static constexpr int TILE_LEVEL = 5;  // nível da pirâmide com um bloco por célula
+    static_assert(1 << TILE_LEVEL == TILE, "TILE_LEVEL deve corresponder a TILE");
+
+    // Opções do construtor
+    static constexpr int WITH_PYRAMID = 1;
+
+    WorldMap(const GridInfo& info, int initial, int options = 0);
+    ~WorldMap();
+
+    WorldMap(const WorldMap&) = delete;
+    WorldMap& operator=(const WorldMap&) = delete;
+
+    // Só lê; fora da thread de mapeamento, prefira view(), que não corre contra set().
+    int get(int linha, int coluna) const {
+        if (isDense(linha, coluna)) return cells_.get(linha, coluna);
+        return getSparse(linha, coluna);
+    }
+
+    int get(const MatrixPosition& pos) const { return get(pos.linha, pos.coluna); }
+
+    void set(const MatrixPosition& pos, int value) {
+        if (isDense(pos.linha, pos.coluna)) {
+            beforeWrite(pos);
+            if (pyramid_) {
+                int before = cells_.get(pos);
+                cells_.set(pos, value);
+                if (cells_.get(pos) != before) cellChanged(pos, before, cells_.get(pos));
+            } else {
+                cells_.set(pos, value);
+            }
+        } else {
+            setSparse(pos, value);
+        }
+    }
+
+    void increment(const MatrixPosition& pos, int amount) { set(pos, get(pos) + amount); }
+
+    void decrement(const MatrixPosition& pos, int amount) { set(pos, get(pos) - amount); }
+
+    struct CellDecrement {
+        MatrixPosition pos;
+        int amount;
+    };
+
+    // Decrementos saturados de células da janela densa, agrupados por bloco: 'cells' vem
+    // ordenada por bloco e 'tileStarts' marca onde cada bloco começa (mais o fim). Os blocos são
+    // divididos entre as threads do pool; cada célula deve aparecer uma vez só, com a soma dos
+    // decrementos, e como decrementos comutam o resultado é o mesmo de aplicá-los um a um.
+    void decrementTiles(const std::vector<CellDecrement>& cells, const std::vector<int>& tileStarts,
+                        WorkerPool& pool);
+
+    // Dimensões e posição da janela densa
+    int rows() const { return cells_.rows(); }
+    int cols() const { return cells_.cols(); }
+    bool empty() const { return cells_.empty(); }
+    const GridInfo& info() const { return cells_.info(); }
+
+    bool isDense(int linha, int coluna) const {
+        return static_cast<unsigned>(linha) < static_cast<unsigned>(cells_.rows())
+            && static_cast<unsigned>(coluna) < static_cast<unsigned>(cells_.cols());
+    }
+
+    bool isDense(const MatrixPosition& pos) const { return isDense(pos.linha, pos.coluna); }
+
+    MatrixPosition findCell(float x, float y) const { return cells_.findCell(x, y); }
+    CellCenter getCellCenter(const MatrixPosition& pos) const { return cells_.getCellCenter(pos); }
+
+    // Só a thread de mapeamento pode usar a grade viva; as demais usam view()
+    const NibbleGrid& cells() const { return cells_; }
+
+    // Valor das células ainda não observadas
+    int initial() const { return initial_; }
+
+    // Versão publicada mais recente; continua válida enquanto o ponteiro for mantido
+    std::shared_ptr<const MapView> view() const { return std::atomic_load(&view_); }
+
+    // Thread de mapeamento, depois de cada leitura: publica uma nova versão se a janela mudou.
+    // Depois de um mapa carregado todos os blocos aparecem como alterados na versão nova.
+    void publishView();
+
+    // nullptr se o mapa foi criado sem WITH_PYRAMID
+    const MapPyramid* pyramid() const { return pyramid_.get(); }
+
+    // Blocos alocados fora da janela densa
+    std::size_t sparseTiles() const { return sparse_.size(); }
+
+    int tileRows() const { return tileRows_; }
+    int tileColumns() const { return tileColumns_; }
+
+    // Há blocos alterados desde o último snapshot?
+    bool hasDirtyTiles() const { return dirtyCount_.load(std::memory_order_relaxed) > 0; }
+
+    // Troca o mapa inteiro (carga de arquivo). O mapa novo só é instalado pela thread de
+    // mapeamento no próximo syncPoint(); falha se houver um snapshot em andamento.
+    bool replace(NibbleGrid&& cells, std::vector<StoredTile>&& sparse);
+
+    // Pede um snapshot; retorna false se o anterior ainda não terminou
+    bool requestSnapshot();
+
+    // Chamado pela thread de mapeamento entre duas atualizações: é aqui que o snapshot
+    // pedido passa a valer e que um mapa carregado é instalado, então nenhuma escrita fica pela metade
+    void syncPoint();
+
+    // Thread de gravação: espera o snapshot começar (até timeout), copia os blocos que ainda
+    // não foram preservados e devolve a janela congelada. Retorna nullptr se não começou.
+    const NibbleGrid* completeSnapshot(std::chrono::milliseconds timeout);
+
+    // Válidos entre completeSnapshot() e releaseSnapshot():
+    // blocos (em coordenadas de bloco) alterados entre o snapshot anterior e o atual
+    const std::vector<MatrixPosition>& snapshotTiles() const { return snapshotTiles_; }
+
+    // todos os blocos esparsos, ordenados por posição
+    const std::vector<StoredTile>& snapshotSparse() const { return snapshotSparse_; }
+
+    // conteúdo de um bloco qualquer no snapshot
+    void snapshotTile(const MatrixPosition& tile, StoredTile& out) const;
+
+    // Libera o snapshot para que um novo possa ser pedido
+    void releaseSnapshot();
+
+private:
+    static constexpr uint32_t BUSY = UINT32_MAX;
+
+    struct SparseTile {
+        NibbleTile cells;
+        bool dirty;
+    };
+
+    // Divisão arredondando para baixo, para células de índice negativo
+    static int tileOf(int cell) { return cell >= 0 ? cell / TILE : -((TILE - 1 - cell) / TILE); }
+
+    bool isDenseTile(const MatrixPosition& tile) const {
+        return static_cast<unsigned>(tile.linha) < static_cast<unsigned>(tileRows_)
+            && static_cast<unsigned>(tile.coluna) < static_cast<unsigned>(tileColumns_);
+    }
+
+    int tileIndex(const MatrixPosition& pos) const {
+        return (pos.linha / TILE) * tileColumns_ + pos.coluna / TILE;
+    }
+
+    void beforeWrite(const MatrixPosition& pos) {
+        int tile = tileIndex(pos);
+        if (!dirty_[tile]) markDirty(tile);
+        tileVersion_[tile] = viewVersion_ + 1;
+
+        uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+        if (tileEpoch_[tile].load(std::memory_order_acquire) != epoch) preserveTile(tile, epoch);
+    }
+
+    int getSparse(int linha, int coluna) const;
+    void setSparse(const MatrixPosition& pos, int value);
+
+    void cellChanged(const MatrixPosition& pos, int before, int after);
+    void install(NibbleGrid&& cells, std::vector<StoredTile>&& sparse);
+    void resetTiles();
+    void markDirty(int tile);
+    void preserveTile(int tile, uint32_t epoch);
+    void copyTile(int tile, NibbleGrid& to) const;
+    void recycle(MapView* view);
+
+    int initial_;
+    NibbleGrid cells_;
+    NibbleGrid snapshot_;
+    SparseTileMap<SparseTile> sparse_;
+    SparseTile blank_;
+    std::unique_ptr<MapPyramid> pyramid_;
+
+    int tileRows_ = 0;
+    int tileColumns_ = 0;
+    std::unique_ptr<std::atomic<uint32_t>[]> tileEpoch_;
+    std::atomic<uint32_t> epoch_{0};
+
+    // Só a thread de mapeamento mexe nestes (escritas e syncPoint)
+    std::vector<uint8_t> dirty_;
+    std::vector<MatrixPosition> dirtyTiles_;
+    std::vector<MatrixPosition> snapshotTiles_;
+    std::vector<StoredTile> snapshotSparse_;
+    std::atomic<int> dirtyCount_{0};
+
+    // Publicação das versões: só a thread de mapeamento escreve nestes
+    std::shared_ptr<const MapView> view_;
+    std::atomic<MapView*> recycled_{nullptr};  // versão que o último leitor soltou, para reaproveitar
+
+    // Mudanças feitas por cada thread em decrementTiles, repassadas depois à pirâmide
+    struct CellChange {
+        MatrixPosition pos;
+        int before;
+        int after;
+    };
+    std::vector<std::vector<CellChange>> changes_;  // uma lista por thread do pool, reaproveitada entre chamadas
+    std::vector<uint64_t> tileVersion_;  // versão em que cada bloco foi escrito por último
+    uint64_t viewVersion_ = 0;
+    bool viewReset_ = true;  // dimensões mudaram: a próxima versão é copiada inteira
+
+    // Mapa carregado esperando o próximo syncPoint()
+    struct Replacement {
+        NibbleGrid cells;
+        std::vector<StoredTile> sparse;
+    };
+    std::unique_ptr<Replacement> replacement_;
+
+    std::mutex snapshotMutex_;
+    std::condition_variable snapshotStarted_;
+    bool requested_ = false;
+    bool active_ = false;
+    std::atomic<bool> busy_{false};
+};
+
+#endif // WORLDMAP_HPP
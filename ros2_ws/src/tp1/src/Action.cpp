@@ -3,39 +3,40 @@
 #include "graphics.hpp"
 #include "Mapping.hpp"
 #include "PotentialField.hpp"
+#include "MapFile.hpp"
+#include "MapSaver.hpp"
 
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <limits>
 #include <vector>
 
-extern std::vector<std::vector<float>> potentialField;  // PotentialField.cpp
-extern std::vector<std::vector<float>> worldMatrix;  // mapping.cpp
+extern OccupancyGrid<float> potentialField;  // PotentialField.cpp
+extern WorldMap worldMatrix;  // mapping.cpp
 extern GridInfo grid;
 
-Position botPosition = {0.0f, 0.0f, 0.0f};
 extern float scaleFactor;
 
 std::vector<Position> positionArray;
-std::vector<float> sonares;
 
 float yawGradiente(
-    const std::vector<std::vector<float>>& potential,
+    const OccupancyGrid<float>& potential,
     float xPosition, float yPosition
 ) {
-    MatrixPosition positionStruct = findCell(xPosition, yPosition, grid.inicio, grid.passo);
+    MatrixPosition positionStruct = potential.findCell(xPosition, yPosition);
 	int x = positionStruct.coluna, y = positionStruct.linha;
-	int width = potentialField[0].size();
-    int height  = potentialField.size();
+	int width = potential.cols();
+    int height  = potential.rows();
 
     if (x <= 0 || x >= width - 1 || y <= 0 || y >= height - 1) {
         std::cout << "Fora de alcance" << std::endl;
         return 0.0f;
     }
 
-    float dx = potential[y][x + 1] - potential[y][x - 1];
-    float dy = potential[y + 1][x] - potential[y - 1][x];
+    float dx = potential(y, x + 1) - potential(y, x - 1);
+    float dy = potential(y + 1, x) - potential(y - 1, x);
 
     return std::atan2(-dy, -dx);
 }
@@ -211,9 +212,8 @@ Position detectarParede(const std::vector<float>& pose, float sonarDistance, boo
 
 void Action::testMode(std::vector<float> lasers, std::vector<float> sonars, std::vector<float> pose)
 {
-    botPosition = {pose[0], pose[1], pose[2]};
-    sonares = sonars;
-    positionArray.push_back(botPosition);
+    (void)sonars;  // as leituras chegam ao mapeamento pelo SensorFeed
+    positionArray.push_back({pose[0], pose[1], pose[2]});
 
     PID pid = { 0.02f, 0.0f, 0.01f }; // parâmetros do PID
 
@@ -226,9 +226,7 @@ void Action::testMode(std::vector<float> lasers, std::vector<float> sonars, std:
 
 void Action::manualRobotMotion(MovingDirection direction, std::vector<float> sonars, std::vector<float> pose)
 {
-    botPosition = {pose[0], pose[1], pose[2]};
-    sonares = sonars;
-    positionArray.push_back(botPosition);
+    positionArray.push_back({pose[0], pose[1], pose[2]});
 
     if(direction == FRONT){
         linVel= 0.5; angVel= 0.0;
@@ -285,6 +283,7 @@ float Action::getAngularVelocity()
 
 bool mapSaved = false;
 bool mapLoaded = false;
+MapSaver mapSaver(worldMatrix, "mapa.bin", "mapa.journal", std::chrono::seconds(5));
 MotionControl Action::handlePressedKey(char key)
 {
     MotionControl mc;
@@ -319,14 +318,53 @@ MotionControl Action::handlePressedKey(char key)
     }else if(key==' '){
         mc.mode=MANUAL;
         mc.direction = STOP;
+    }else if(key=='h' or key=='H'){
+        mappingMode = MAP_HIMM;
+    }else if(key=='b' or key=='B'){
+        mappingMode = MAP_BAYES;
+    }else if(key=='l' or key=='L'){
+        mappingMode = MAP_LASER;
+    }else if(key=='p' or key=='P'){
+        parallelMapping = !parallelMapping.load();
+        std::cout << "Integração HIMM " << (parallelMapping.load() ? "paralela" : "serial") << std::endl;
+    }else if(key=='f' or key=='F'){
+        fullFieldSolve = !fullFieldSolve.load();
+        std::cout << "Campo potencial " << (fullFieldSolve.load() ? "no mapa inteiro (multigrid)" : "em volta do robô (SOR)") << std::endl;
+    }else if(key=='o' or key=='O'){
+        // Próximo passo de 0.1 em [1.0, 1.9]; depois de 1.9 volta a 0 (ótimo para a janela)
+        float omega = sorOmega.load();
+        omega = omega <= 0.0f ? 1.0f : std::round(omega * 10.0f + 1.0f) / 10.0f;
+        if (omega >= 2.0f) omega = 0.0f;
+        sorOmega = omega;
+        if (omega > 0.0f) std::cout << "SOR com w = " << omega << std::endl;
+        else std::cout << "SOR com o w ótimo para a janela" << std::endl;
     }else if(key=='v' or key=='V'){
         if(!mapSaved){
-            salvaMatriz(worldMatrix, "matriz.txt");
+            // A cópia e a escrita no disco acontecem na thread do MapSaver, que a partir daqui
+            // também grava checkpoints incrementais em 'mapa.journal'
+            if (!mapSaver.save()) {
+                std::cout << "Gravação anterior do mapa ainda em andamento." << std::endl;
+            }
         }
 		mapSaved = !mapSaved;
     }else if(key=='c' or key=='C'){
         if(!mapLoaded){
-            worldMatrix = loadMatrix("matriz.txt");
+            auto start = std::chrono::steady_clock::now();
+            NibbleGrid loaded;
+            std::vector<StoredTile> sparse;
+            uint64_t checksum = 0;
+            if (loadMapFile(loaded, sparse, "mapa.bin", &checksum)) {
+                // Checkpoints gravados depois do mapa completo
+                if (replayMapJournal(loaded, sparse, checksum, "mapa.journal") < 0) {
+                    std::cout << "Journal 'mapa.journal' ignorado: não corresponde a 'mapa.bin'." << std::endl;
+                }
+                if (worldMatrix.replace(std::move(loaded), std::move(sparse))) {
+                    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                    std::cout << "Mapa carregado de 'mapa.bin' (" << us.count() << " us)." << std::endl;
+                } else {
+                    std::cout << "Mapa não carregado: gravação em andamento." << std::endl;
+                }
+            }
         }
 		mapLoaded = !mapLoaded;
     }
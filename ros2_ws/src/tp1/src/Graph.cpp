@@ -1,5 +1,7 @@
 #include "graphics.hpp"
 #include "Mapping.hpp"
+#include "MapQuadtree.hpp"
+#include "SensorFrame.hpp"
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <cmath>
@@ -7,10 +9,9 @@
 #include <fstream>
 #include <algorithm>
 
-// Variável global ou extern para compartilhar posição do robô
-extern Position botPosition;
+// A posição do robô vem do quadro de sensores mais recente
+extern SensorFeed sensorFeed;
 extern float scaleFactor;
-extern std::vector<float> sonares;
 extern std::vector<float> offset;
 extern std::vector<double> sensorAngles;
 
@@ -21,10 +22,10 @@ extern std::vector<Position> path;
 // Cria Grade e Matrizes
 extern GridInfo grid;
 extern int size;  
-extern std::vector<std::vector<float>> worldMatrix;
-extern std::vector<std::vector<int>> matrizPath;
-extern std::vector<std::vector<bool>> knownRegion;
-extern std::vector<std::vector<float>> potentialField;
+extern WorldMap worldMatrix;
+extern OccupancyGrid<int> matrizPath;
+extern BitGrid knownRegion;
+extern OccupancyGrid<float> potentialField;
 
 
 void desenhaGrade(float inicio, float fim, float passo) {
@@ -51,33 +52,6 @@ void desenhaGrade(float inicio, float fim, float passo) {
     glEnd();
 }
 
-void pintaCelulas(const std::vector<std::vector<float>>& matriz, float inicio, float passo) {
-    int linhas = matriz.size();
-    int colunas = matriz[0].size();
-
-    for (int i = 0; i < linhas; ++i) {
-        for (int j = 0; j < colunas; ++j) {
-            float x = inicio + j * passo;
-            float y = inicio + i * passo;
-
-            float matVal = matriz[i][j];
-            if(matVal >= 1){
-                matVal = matVal / 15.0f;
-            }
-            float cellColor = 1.0f * (1 - matVal);
-
-            glColor3f(cellColor, cellColor, cellColor);  // Cores em escala de cinza para as células
-            glBegin(GL_QUADS);
-                glVertex2f(x, y);
-                glVertex2f(x + passo, y);
-                glVertex2f(x + passo, y + passo);
-                glVertex2f(x, y + passo);
-            glEnd();
-        
-        }
-    }
-}
-
 void desenhaRobo(const Position& posRobo) {
     glColor3f(0.0f, 0.0f, 0.8f);  // Azul escuro para o robô
     float tamanho = 0.01f;
@@ -107,6 +81,110 @@ void desenhaDirecao(const Position& posRobo) {
     glEnd();
 }
 
+// Quadtree e pirâmide só da thread gráfica, acompanhando as versões publicadas do mapa: assim o
+// desenho não divide lock nenhum com a thread de mapeamento
+struct MapaDesenhado {
+    bool pronto = false;
+    uint64_t versao = 0;
+    NibbleGrid celulas;
+    MapQuadtree quadtree;
+    MapPyramid pyramid;
+};
+
+// Traz o mapa desenhado para a versão 'view', refazendo só as células dos blocos alterados desde
+// a versão anterior (um mapa carregado marca todos os blocos)
+void atualizaMapa(MapaDesenhado& mapa, const WorldMap::MapView& view) {
+    if (mapa.pronto && mapa.versao == view.version) return;
+
+    if (!mapa.pronto || mapa.celulas.rows() != view.cells.rows() || mapa.celulas.cols() != view.cells.cols()) {
+        mapa.pyramid.detach();
+        mapa.celulas = view.cells;
+        mapa.quadtree.build(mapa.celulas, worldMatrix.initial());
+        mapa.pyramid.build(mapa.celulas);
+    } else {
+        const int lado = WorldMap::TILE;
+        int blocosPorLinha = view.cells.cols() / lado;
+        for (int t = 0; t < static_cast<int>(view.tileVersion.size()); ++t) {
+            if (view.tileVersion[t] <= mapa.versao) continue;
+
+            int linha0 = (t / blocosPorLinha) * lado, coluna0 = (t % blocosPorLinha) * lado;
+            for (int i = linha0; i < linha0 + lado; ++i) {
+                for (int j = coluna0; j < coluna0 + lado; ++j) {
+                    int antes = mapa.celulas.get(i, j), depois = view.cells.get(i, j);
+                    if (antes == depois) continue;
+                    mapa.celulas.set(i, j, depois);
+                    mapa.quadtree.update(i, j, depois);
+                    mapa.pyramid.update(i, j, antes, depois);
+                }
+            }
+        }
+    }
+    mapa.versao = view.version;
+    mapa.pronto = true;
+}
+
+// Um quad por folha da quadtree: regiões uniformes (quase todo o mapa) custam um único quad
+void pintaFolhas(const MapQuadtree& quadtree, float inicio, float passo) {
+    struct Folha {
+        int linha, coluna, tamanho, valor;
+    };
+    static std::vector<Folha> folhas;
+
+    // Copia as folhas antes de desenhar para não segurar a quadtree durante as chamadas de OpenGL
+    folhas.clear();
+    quadtree.forEachLeaf([&](int linha, int coluna, int tamanho, int valor) {
+        folhas.push_back({linha, coluna, tamanho, valor});
+    });
+
+    glBegin(GL_QUADS);
+    for (const Folha& folha : folhas) {
+        int linhas = std::min(folha.tamanho, size - folha.linha);
+        int colunas = std::min(folha.tamanho, size - folha.coluna);
+        if (linhas <= 0 || colunas <= 0) continue;
+
+        float x = inicio + folha.coluna * passo;
+        float y = inicio + folha.linha * passo;
+        float cellColor = 1.0f - folha.valor / 15.0f;
+
+        glColor3f(cellColor, cellColor, cellColor);
+        glVertex2f(x, y);
+        glVertex2f(x + colunas * passo, y);
+        glVertex2f(x + colunas * passo, y + linhas * passo);
+        glVertex2f(x, y + linhas * passo);
+    }
+    glEnd();
+}
+
+// Nível de detalhe: cada quad é um bloco da pirâmide com a média do bloco, ou o máximo quando
+// há obstáculo nele, para as paredes não sumirem ao reduzir a janela
+void pintaNivel(const MapPyramid& pyramid, int level, float inicio, float passo) {
+    struct Bloco {
+        int linha, coluna;
+        float valor;
+    };
+    static std::vector<Bloco> blocos;
+
+    blocos.clear();
+    pyramid.forEachBlock(level, [&](int linha, int coluna, int maximo, float media) {
+        blocos.push_back({linha, coluna, maximo > 10 ? static_cast<float>(maximo) : media});
+    });
+
+    float lado = passo * (1 << level);
+    glBegin(GL_QUADS);
+    for (const Bloco& bloco : blocos) {
+        float x = inicio + bloco.coluna * lado;
+        float y = inicio + bloco.linha * lado;
+        float cellColor = 1.0f - bloco.valor / 15.0f;
+
+        glColor3f(cellColor, cellColor, cellColor);
+        glVertex2f(x, y);
+        glVertex2f(x + lado, y);
+        glVertex2f(x + lado, y + lado);
+        glVertex2f(x, y + lado);
+    }
+    glEnd();
+}
+
 void desenhaKnownRegion(GLFWwindow* windowKnown) {
     glfwMakeContextCurrent(windowKnown);
     glViewport(0, 0, 200, 200);
@@ -118,22 +196,22 @@ void desenhaKnownRegion(GLFWwindow* windowKnown) {
     glClearColor(1.0, 1.0, 1.0, 1.0);  // Fundo branco para a janela HIMM
     glClear(GL_COLOR_BUFFER_BIT);
 
-    for (size_t i = 0; i < knownRegion.size(); ++i) {
-        for (size_t j = 0; j < knownRegion[i].size(); ++j) {
-            if (knownRegion[i][j]) {
-                float x = grid.inicio + j * grid.passo;
-                float y = grid.inicio + i * grid.passo;
-
-                glColor3f(0.0f, 0.0f, 0.0f);  // Preto para a região conhecida
-                glBegin(GL_QUADS);
-                glVertex2f(x, y);
-                glVertex2f(x + grid.passo, y);
-                glVertex2f(x + grid.passo, y + grid.passo);
-                glVertex2f(x, y + grid.passo);
-                glEnd();
-            }
-        }
+    // Um quad por sequência contínua de células conhecidas em cada linha
+    glColor3f(0.0f, 0.0f, 0.0f);  // Preto para a região conhecida
+    glBegin(GL_QUADS);
+    for (int i = 0; i < knownRegion.rows(); ++i) {
+        float y = grid.inicio + i * grid.passo;
+        knownRegion.forEachSpan(i, [&](int begin, int end) {
+            float xBegin = grid.inicio + begin * grid.passo;
+            float xEnd = grid.inicio + end * grid.passo;
+
+            glVertex2f(xBegin, y);
+            glVertex2f(xEnd, y);
+            glVertex2f(xEnd, y + grid.passo);
+            glVertex2f(xBegin, y + grid.passo);
+        });
     }
+    glEnd();
 
     glfwSwapBuffers(windowKnown);
 }
@@ -144,9 +222,10 @@ void desenhaCampoPotencial(GLFWwindow* window) {
     glLoadIdentity();
     glOrtho(grid.inicio, grid.fim, grid.inicio, grid.fim, -1.0, 1.0); // Projeção 2D
 
-    for (size_t y = 0; y < potentialField.size(); ++y) {
-        for (size_t x = 0; x < potentialField[y].size(); ++x) {
-            float valor = std::clamp(potentialField[y][x], 0.0f, 1.0f);
+    for (int y = 0; y < potentialField.rows(); ++y) {
+        const float* linha = potentialField.row(y);
+        for (int x = 0; x < potentialField.cols(); ++x) {
+            float valor = std::clamp(linha[x], 0.0f, 1.0f);
 
             // Interpolação entre azul e vermelho
             float r = valor;
@@ -192,7 +271,9 @@ void* graphicsThreadFunction(void* arg) {
     // Fundo preto para a janela Mapping
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);  // Fundo preto para a janela Mapping
 
+    MapaDesenhado mapaDesenhado;
     while (!glfwWindowShouldClose(window) && !glfwWindowShouldClose(windowKnown) && !glfwWindowShouldClose(windowCampo)) {
+        const Position& botPosition = sensorFeed.latest(SensorFeed::GRAPHICS).pose;
         Position posRobo = {
             botPosition.x * scaleFactor - offset[0], 
             botPosition.y * scaleFactor - offset[1],
@@ -203,7 +284,21 @@ void* graphicsThreadFunction(void* arg) {
         // Janela de criação de mapa
         glfwMakeContextCurrent(window);
         glClear(GL_COLOR_BUFFER_BIT);
-        pintaCelulas(worldMatrix, grid.inicio, grid.passo);
+
+        // Com menos pixels do que células, desenha o nível da pirâmide com ~1 bloco por pixel
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        atualizaMapa(mapaDesenhado, *worldMatrix.view());
+        int level = 0;
+        while (level < mapaDesenhado.pyramid.levels() && (size >> (level + 1)) >= std::min(fbWidth, fbHeight)) {
+            ++level;
+        }
+
+        if (level > 0) {
+            pintaNivel(mapaDesenhado.pyramid, level, grid.inicio, grid.passo);
+        } else {
+            pintaFolhas(mapaDesenhado.quadtree, grid.inicio, grid.passo);
+        }
         desenhaRobo(posRobo);
         desenhaDirecao(posRobo);
         glfwSwapBuffers(window);
@@ -0,0 +1,282 @@
+#include "MapFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void unmapFile(void* base, std::size_t length)
+{
+    munmap(base, length);
+}
+
+bool writeAll(int fd, const void* data, std::size_t bytes)
+{
+    const char* ptr = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = write(fd, ptr, bytes);
+        if (written <= 0) return false;
+        ptr += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+using TileIndex = std::unordered_map<uint64_t, std::size_t>;
+
+uint64_t tileKey(const MatrixPosition& tile)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tile.linha)) << 32) | static_cast<uint32_t>(tile.coluna);
+}
+
+// Copia um bloco para a grade, se ele estiver dentro dela, ou para a lista de blocos esparsos
+void applyTile(NibbleGrid& map, std::vector<StoredTile>& sparse, TileIndex& index, const StoredTile& stored)
+{
+    const int TILE = NibbleTile::SIZE;
+    int firstLine = stored.tile.linha * TILE,
+        firstColumn = stored.tile.coluna * TILE;
+
+    if (stored.tile.linha >= 0 && stored.tile.coluna >= 0 && firstLine < map.rows() && firstColumn < map.cols()) {
+        int lines = std::min(TILE, map.rows() - firstLine),
+            bytes = std::min(TILE / 2, (map.cols() + 1) / 2 - firstColumn / 2);
+        for (int l = 0; l < lines; ++l) {
+            std::memcpy(map.row(firstLine + l) + firstColumn / 2, stored.cells.bytes[l], bytes);
+        }
+        return;
+    }
+
+    auto inserted = index.emplace(tileKey(stored.tile), sparse.size());
+    if (inserted.second) sparse.push_back(stored);
+    else sparse[inserted.first->second].cells = stored.cells;
+}
+
+}
+
+uint64_t mapChecksum(const uint8_t* data, std::size_t bytes, uint64_t seed)
+{
+    // FNV-1a aplicado a palavras de 64 bits; o payload tem sempre tamanho múltiplo de 64 bytes
+    uint64_t hash = seed;
+    std::size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    for (; i < bytes; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool saveMapFile(const NibbleGrid& map, const std::vector<StoredTile>& sparse, const std::string& fileName,
+                 uint64_t* checksum)
+{
+    const uint8_t* tiles = reinterpret_cast<const uint8_t*>(sparse.data());
+    std::size_t tileBytes = sparse.size() * sizeof(StoredTile);
+
+    MapFileHeader header = {};
+    std::memcpy(header.magic, "TP1M", 4);
+    header.version = MAP_FILE_VERSION;
+    header.inicio = map.info().inicio;
+    header.fim = map.info().fim;
+    header.passo = map.info().passo;
+    header.rows = map.rows();
+    header.cols = map.cols();
+    header.cellType = MAP_CELL_NIBBLE;
+    header.stride = map.stride();
+    header.payloadBytes = map.bytes();
+    header.sparseTiles = sparse.size();
+    header.checksum = mapChecksum(tiles, tileBytes, mapChecksum(map.data(), map.bytes()));
+
+    int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Erro ao acessar '" << fileName << "' para escrita." << std::endl;
+        return false;
+    }
+
+    bool ok = writeAll(fd, &header, sizeof(header)) && writeAll(fd, map.data(), map.bytes())
+        && writeAll(fd, tiles, tileBytes);
+    close(fd);
+
+    if (!ok) std::cerr << "Erro ao gravar '" << fileName << "'." << std::endl;
+    if (ok && checksum) *checksum = header.checksum;
+    return ok;
+}
+
+bool loadMapFile(NibbleGrid& map, std::vector<StoredTile>& sparse, const std::string& fileName,
+                 uint64_t* checksum)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Erro ao acessar '" << fileName << "' para leitura." << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(MapFileHeader)) {
+        std::cerr << "Arquivo de mapa '" << fileName << "' invalido." << std::endl;
+        close(fd);
+        return false;
+    }
+
+    std::size_t length = info.st_size;
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Erro ao mapear '" << fileName << "' em memoria." << std::endl;
+        return false;
+    }
+
+    const MapFileHeader* header = static_cast<const MapFileHeader*>(base);
+    uint8_t* payload = static_cast<uint8_t*>(base) + sizeof(MapFileHeader);
+    std::size_t available = length - sizeof(MapFileHeader);
+
+    bool valid = std::memcmp(header->magic, "TP1M", 4) == 0
+        && header->version == MAP_FILE_VERSION
+        && header->cellType == MAP_CELL_NIBBLE
+        && header->rows > 0 && header->cols > 0
+        && header->stride >= static_cast<uint64_t>((header->cols + 1) / 2)
+        && header->payloadBytes == header->stride * header->rows
+        && header->payloadBytes <= available
+        && header->sparseTiles <= (available - header->payloadBytes) / sizeof(StoredTile);
+
+    std::size_t tileBytes = valid ? header->sparseTiles * sizeof(StoredTile) : 0;
+    const uint8_t* tiles = payload + (valid ? header->payloadBytes : 0);
+    valid = valid && header->checksum == mapChecksum(tiles, tileBytes, mapChecksum(payload, header->payloadBytes));
+
+    if (!valid) {
+        std::cerr << "Arquivo de mapa '" << fileName << "' invalido ou corrompido." << std::endl;
+        munmap(base, length);
+        return false;
+    }
+
+    if (checksum) *checksum = header->checksum;
+
+    sparse.resize(header->sparseTiles);
+    std::memcpy(static_cast<void*>(sparse.data()), tiles, tileBytes);
+
+    GridInfo grid = {header->inicio, header->fim, header->passo};
+    map.adopt(payload, header->rows, header->cols, header->stride, grid, base, length, unmapFile);
+    return true;
+}
+
+bool resetMapJournal(const std::string& fileName, const NibbleGrid& map, uint64_t baseChecksum)
+{
+    MapJournalHeader header = {};
+    std::memcpy(header.magic, "TP1J", 4);
+    header.version = MAP_FILE_VERSION;
+    header.baseChecksum = baseChecksum;
+    header.rows = map.rows();
+    header.cols = map.cols();
+    header.tileSize = NibbleTile::SIZE;
+
+    int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Erro ao acessar '" << fileName << "' para escrita." << std::endl;
+        return false;
+    }
+
+    bool ok = writeAll(fd, &header, sizeof(header));
+    close(fd);
+
+    if (!ok) std::cerr << "Erro ao gravar '" << fileName << "'." << std::endl;
+    return ok;
+}
+
+long appendMapJournal(const std::vector<StoredTile>& tiles, const std::string& fileName)
+{
+    // Registro e blocos vão em dois writes seguidos: um registro cortado no meio por uma queda
+    // não confere com o checksum e é descartado na leitura
+    std::size_t tileBytes = tiles.size() * sizeof(StoredTile);
+
+    MapJournalRecord record = {};
+    std::memcpy(record.magic, "TP1C", 4);
+    record.tiles = tiles.size();
+    record.checksum = mapChecksum(reinterpret_cast<const uint8_t*>(tiles.data()), tileBytes);
+
+    int fd = open(fileName.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        std::cerr << "Erro ao acessar '" << fileName << "' para escrita." << std::endl;
+        return -1;
+    }
+
+    bool ok = writeAll(fd, &record, sizeof(record)) && writeAll(fd, tiles.data(), tileBytes);
+    off_t size = lseek(fd, 0, SEEK_END);
+    close(fd);
+
+    if (!ok) {
+        std::cerr << "Erro ao gravar '" << fileName << "'." << std::endl;
+        return -1;
+    }
+    return size;
+}
+
+int replayMapJournal(NibbleGrid& map, std::vector<StoredTile>& sparse, uint64_t baseChecksum,
+                     const std::string& fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return 0;  // sem journal, o mapa base já está completo
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(MapJournalHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    std::size_t length = info.st_size;
+    void* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Erro ao mapear '" << fileName << "' em memoria." << std::endl;
+        return -1;
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(base);
+    const MapJournalHeader* header = static_cast<const MapJournalHeader*>(base);
+
+    if (std::memcmp(header->magic, "TP1J", 4) != 0 || header->version != MAP_FILE_VERSION
+        || header->baseChecksum != baseChecksum
+        || header->rows != map.rows() || header->cols != map.cols()
+        || header->tileSize != NibbleTile::SIZE) {
+        munmap(base, length);
+        return -1;
+    }
+
+    TileIndex index;
+    for (std::size_t i = 0; i < sparse.size(); ++i) index.emplace(tileKey(sparse[i].tile), i);
+
+    std::size_t offset = sizeof(MapJournalHeader);
+    int applied = 0;
+
+    while (offset + sizeof(MapJournalRecord) <= length) {
+        MapJournalRecord record;
+        std::memcpy(&record, data + offset, sizeof(record));
+        const uint8_t* in = data + offset + sizeof(record);
+
+        if (std::memcmp(record.magic, "TP1C", 4) != 0
+            || record.tiles > (length - offset - sizeof(record)) / sizeof(StoredTile)) break;
+
+        std::size_t tileBytes = record.tiles * sizeof(StoredTile);
+        if (mapChecksum(in, tileBytes) != record.checksum) break;
+
+        for (uint32_t t = 0; t < record.tiles; ++t) {
+            StoredTile stored;
+            std::memcpy(&stored, in + t * sizeof(StoredTile), sizeof(stored));
+            applyTile(map, sparse, index, stored);
+        }
+
+        offset += sizeof(record) + tileBytes;
+        ++applied;
+    }
+
+    munmap(base, length);
+    return applied;
+}
@@ -0,0 +1,161 @@
+#include "MapPyramid.hpp"
+
+#include <algorithm>
+
+void MapPyramid::build(const NibbleGrid& grid)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    grid_ = &grid;
+    levels_.clear();
+
+    int rows = grid.rows(), cols = grid.cols();
+    while (rows > 1 || cols > 1) {
+        rows = (rows + 1) / 2;
+        cols = (cols + 1) / 2;
+
+        Level lv;
+        lv.max.reset(rows, cols, grid.info(), 0);
+        lv.sum.reset(rows, cols, grid.info(), 0u);
+        levels_.push_back(std::move(lv));
+
+        // Cada bloco a partir dos até 4 filhos do nível de baixo
+        int level = levels();
+        Level& current = levels_.back();
+        int childRows = level == 1 ? grid.rows() : levels_[level - 2].max.rows(),
+            childCols = level == 1 ? grid.cols() : levels_[level - 2].max.cols();
+
+        for (int l = 0; l < rows; ++l) {
+            for (int c = 0; c < cols; ++c) {
+                int maxValue = 0;
+                uint32_t sum = 0;
+                for (int cl = 2 * l; cl < std::min(2 * l + 2, childRows); ++cl) {
+                    for (int cc = 2 * c; cc < std::min(2 * c + 2, childCols); ++cc) {
+                        if (level == 1) {
+                            int value = grid.get(cl, cc);
+                            maxValue = std::max(maxValue, value);
+                            sum += value;
+                        } else {
+                            maxValue = std::max(maxValue, static_cast<int>(levels_[level - 2].max(cl, cc)));
+                            sum += levels_[level - 2].sum(cl, cc);
+                        }
+                    }
+                }
+                current.max(l, c) = maxValue;
+                current.sum(l, c) = sum;
+            }
+        }
+    }
+}
+
+void MapPyramid::detach()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    grid_ = nullptr;
+    levels_.clear();
+}
+
+void MapPyramid::update(int linha, int coluna, int before, int after)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    uint32_t delta = static_cast<uint32_t>(after - before);
+    bool maxChanged = true;
+
+    for (int level = 1; level <= levels(); ++level) {
+        int l = linha >> level, c = coluna >> level;
+        Level& lv = levels_[level - 1];
+
+        lv.sum(l, c) += delta;  // aritmética módulo 2^32: funciona também para delta negativo
+        if (!maxChanged) continue;
+
+        // 'before' e 'after' passam a ser o máximo antigo e o novo do bloco do nível de baixo
+        int oldMax = lv.max(l, c), newMax = oldMax;
+        if (after > oldMax) {
+            newMax = after;
+        } else if (before == oldMax && after < before) {
+            newMax = 0;
+            int childRows = rows(level - 1), childCols = cols(level - 1);
+            for (int cl = 2 * l; cl < std::min(2 * l + 2, childRows); ++cl) {
+                for (int cc = 2 * c; cc < std::min(2 * c + 2, childCols); ++cc) {
+                    newMax = std::max(newMax, maxAt(level - 1, cl, cc));
+                }
+            }
+        }
+
+        lv.max(l, c) = newMax;
+        maxChanged = newMax != oldMax;
+        before = oldMax;
+        after = newMax;
+    }
+}
+
+int MapPyramid::rows(int level) const
+{
+    return level == 0 ? grid_->rows() : levels_[level - 1].max.rows();
+}
+
+int MapPyramid::cols(int level) const
+{
+    return level == 0 ? grid_->cols() : levels_[level - 1].max.cols();
+}
+
+int MapPyramid::maxAt(int level, int linha, int coluna) const
+{
+    return level == 0 ? grid_->get(linha, coluna) : levels_[level - 1].max(linha, coluna);
+}
+
+float MapPyramid::mean(int level, int linha, int coluna) const
+{
+    if (level == 0) return grid_->get(linha, coluna);
+
+    // Blocos da borda cobrem menos células
+    int size = 1 << level;
+    int covered = std::min(size, grid_->rows() - linha * size) * std::min(size, grid_->cols() - coluna * size);
+    return static_cast<float>(levels_[level - 1].sum(linha, coluna)) / covered;
+}
+
+int MapPyramid::blockMax(int level, int linha, int coluna) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return maxAt(level, linha, coluna);
+}
+
+float MapPyramid::blockMean(int level, int linha, int coluna) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return mean(level, linha, coluna);
+}
+
+bool MapPyramid::anyAbove(int linha0, int coluna0, int linha1, int coluna1, int threshold) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (!grid_ || grid_->empty()) return false;
+
+    linha0 = std::max(linha0, 0);
+    coluna0 = std::max(coluna0, 0);
+    linha1 = std::min(linha1, grid_->rows());
+    coluna1 = std::min(coluna1, grid_->cols());
+    if (linha0 >= linha1 || coluna0 >= coluna1) return false;
+
+    return anyAbove(levels(), 0, 0, linha0, coluna0, linha1, coluna1, threshold);
+}
+
+bool MapPyramid::anyAbove(int level, int linha, int coluna,
+                          int linha0, int coluna0, int linha1, int coluna1, int threshold) const
+{
+    if (linha >= rows(level) || coluna >= cols(level)) return false;
+    if (maxAt(level, linha, coluna) <= threshold) return false;
+
+    int size = 1 << level,
+        top = linha * size, left = coluna * size;
+    if (top >= linha1 || left >= coluna1 || top + size <= linha0 || left + size <= coluna0) return false;
+
+    // Bloco inteiro dentro da caixa (sempre o caso no nível 0): o máximo já responde
+    if (top >= linha0 && left >= coluna0 && top + size <= linha1 && left + size <= coluna1) return true;
+
+    return anyAbove(level - 1, 2 * linha, 2 * coluna, linha0, coluna0, linha1, coluna1, threshold)
+        || anyAbove(level - 1, 2 * linha, 2 * coluna + 1, linha0, coluna0, linha1, coluna1, threshold)
+        || anyAbove(level - 1, 2 * linha + 1, 2 * coluna, linha0, coluna0, linha1, coluna1, threshold)
+        || anyAbove(level - 1, 2 * linha + 1, 2 * coluna + 1, linha0, coluna0, linha1, coluna1, threshold);
+}
@@ -0,0 +1,160 @@
+#include "MapQuadtree.hpp"
+
+#include <algorithm>
+
+void MapQuadtree::build(const NibbleGrid& grid, int initial)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    rows_ = grid.rows();
+    cols_ = grid.cols();
+    initial_ = NibbleGrid::saturate(initial);
+    size_ = 1;
+    while (size_ < std::max(rows_, cols_)) size_ *= 2;
+
+    nodes_.assign(1, Node{-1, 0, 0});
+    freeChildren_.clear();
+    buildNode(0, grid, 0, 0, size_);
+}
+
+void MapQuadtree::buildNode(int node, const NibbleGrid& grid, int linha, int coluna, int size)
+{
+    // Fora da grade tudo fica com o valor inicial
+    if (linha >= rows_ || coluna >= cols_) {
+        nodes_[node] = {-1, static_cast<uint8_t>(initial_), static_cast<uint8_t>(initial_)};
+        return;
+    }
+    if (size == 1) {
+        uint8_t value = grid.get(linha, coluna);
+        nodes_[node] = {-1, value, value};
+        return;
+    }
+
+    int half = size / 2;
+    int first = allocateChildren(0);
+    buildNode(first, grid, linha, coluna, half);
+    buildNode(first + 1, grid, linha, coluna + half, half);
+    buildNode(first + 2, grid, linha + half, coluna, half);
+    buildNode(first + 3, grid, linha + half, coluna + half, half);
+
+    nodes_[node].firstChild = first;
+    collapse(node);
+}
+
+void MapQuadtree::update(int linha, int coluna, int value)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    uint8_t v = NibbleGrid::saturate(value);
+
+    // Desce até a célula, dividindo as folhas uniformes que estiverem no caminho
+    int path[32];
+    int depth = 0;
+    int node = 0, linha0 = 0, coluna0 = 0, size = size_;
+
+    while (size > 1) {
+        if (nodes_[node].firstChild < 0) {
+            if (nodes_[node].value == v) return;
+            int first = allocateChildren(nodes_[node].value);
+            nodes_[node].firstChild = first;
+        }
+        path[depth++] = node;
+
+        size /= 2;
+        int quadrant = 0;
+        if (linha >= linha0 + size) {
+            quadrant += 2;
+            linha0 += size;
+        }
+        if (coluna >= coluna0 + size) {
+            quadrant += 1;
+            coluna0 += size;
+        }
+        node = nodes_[node].firstChild + quadrant;
+    }
+
+    nodes_[node].value = v;
+    nodes_[node].maxValue = v;
+
+    // Sobe juntando os filhos que ficaram iguais e refazendo os máximos
+    while (depth > 0) collapse(path[--depth]);
+}
+
+void MapQuadtree::collapse(int node)
+{
+    int first = nodes_[node].firstChild;
+    const Node* children = &nodes_[first];
+
+    bool uniform = true;
+    uint8_t maxValue = 0;
+    for (int k = 0; k < 4; ++k) {
+        uniform = uniform && children[k].firstChild < 0 && children[k].value == children[0].value;
+        maxValue = std::max(maxValue, children[k].maxValue);
+    }
+
+    if (uniform) {
+        uint8_t value = children[0].value;
+        releaseChildren(first);
+        nodes_[node] = {-1, value, value};
+    } else {
+        nodes_[node].maxValue = maxValue;
+    }
+}
+
+int MapQuadtree::allocateChildren(uint8_t value)
+{
+    int first;
+    if (!freeChildren_.empty()) {
+        first = freeChildren_.back();
+        freeChildren_.pop_back();
+    } else {
+        first = nodes_.size();
+        nodes_.resize(nodes_.size() + 4);
+    }
+
+    for (int k = 0; k < 4; ++k) nodes_[first + k] = {-1, value, value};
+    return first;
+}
+
+void MapQuadtree::releaseChildren(int first)
+{
+    freeChildren_.push_back(first);
+}
+
+bool MapQuadtree::anyAbove(int linha0, int coluna0, int linha1, int coluna1, int threshold) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (nodes_.empty()) return false;
+
+    linha0 = std::max(linha0, 0);
+    coluna0 = std::max(coluna0, 0);
+    linha1 = std::min(linha1, rows_);
+    coluna1 = std::min(coluna1, cols_);
+    if (linha0 >= linha1 || coluna0 >= coluna1) return false;
+
+    return anyAbove(0, 0, 0, size_, linha0, coluna0, linha1, coluna1, threshold);
+}
+
+bool MapQuadtree::anyAbove(int node, int linha, int coluna, int size,
+                           int linha0, int coluna0, int linha1, int coluna1, int threshold) const
+{
+    const Node& n = nodes_[node];
+    if (n.maxValue <= threshold) return false;
+    if (linha >= linha1 || coluna >= coluna1 || linha + size <= linha0 || coluna + size <= coluna0) return false;
+
+    // Folha uniforme acima do limiar, ou nó inteiro dentro da caixa: o máximo já responde
+    if (n.firstChild < 0) return true;
+    if (linha >= linha0 && coluna >= coluna0 && linha + size <= linha1 && coluna + size <= coluna1) return true;
+
+    int half = size / 2;
+    return anyAbove(n.firstChild, linha, coluna, half, linha0, coluna0, linha1, coluna1, threshold)
+        || anyAbove(n.firstChild + 1, linha, coluna + half, half, linha0, coluna0, linha1, coluna1, threshold)
+        || anyAbove(n.firstChild + 2, linha + half, coluna, half, linha0, coluna0, linha1, coluna1, threshold)
+        || anyAbove(n.firstChild + 3, linha + half, coluna + half, half, linha0, coluna0, linha1, coluna1, threshold);
+}
+
+std::size_t MapQuadtree::leafCount() const
+{
+    std::size_t leaves = 0;
+    forEachLeaf([&](int, int, int, int) { ++leaves; });
+    return leaves;
+}
@@ -0,0 +1,98 @@
+#include "MapSaver.hpp"
+
+#include <iostream>
+
+#include "MapFile.hpp"
+
+MapSaver::MapSaver(WorldMap& map, const std::string& mapName, const std::string& journalName,
+                   std::chrono::milliseconds autosavePeriod)
+    : map_(map), mapName_(mapName), journalName_(journalName), autosavePeriod_(autosavePeriod)
+{
+}
+
+MapSaver::~MapSaver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    pending_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool MapSaver::save()
+{
+    if (!map_.requestSnapshot()) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hasJob_ = true;
+        // A thread só é criada no primeiro pedido; a partir daí ela também faz o autosave
+        if (!thread_.joinable()) thread_ = std::thread(&MapSaver::run, this);
+    }
+    pending_.notify_one();
+    return true;
+}
+
+void MapSaver::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        bool full = pending_.wait_for(lock, autosavePeriod_, [this] { return hasJob_ || stop_; });
+        if (stop_) break;
+        hasJob_ = false;
+
+        // Autosave: só vale a pena se algum bloco mudou
+        if (!full && !(map_.hasDirtyTiles() && map_.requestSnapshot())) continue;
+
+        lock.unlock();
+        writeSnapshot(full);
+        lock.lock();
+    }
+}
+
+void MapSaver::writeSnapshot(bool full)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // O snapshot começa no próximo syncPoint da thread de mapeamento
+    const NibbleGrid* snapshot = nullptr;
+    while (!snapshot) {
+        snapshot = map_.completeSnapshot(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) break;
+    }
+
+    if (snapshot) {
+        bool compact = hasBase_ && journalBytes_ > static_cast<long>(snapshot->bytes());
+
+        if (full || compact || !hasBase_) {
+            uint64_t checksum = 0;
+            hasBase_ = saveMapFile(*snapshot, map_.snapshotSparse(), mapName_, &checksum)
+                && resetMapJournal(journalName_, *snapshot, checksum);
+            journalBytes_ = sizeof(MapJournalHeader);
+
+            if (hasBase_) {
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                std::cout << "Mapa salvo em '" << mapName_ << "'" << (compact ? " (journal compactado)" : "")
+                          << " (" << us.count() << " us)." << std::endl;
+            }
+        } else {
+            const std::vector<MatrixPosition>& dirty = map_.snapshotTiles();
+            journalTiles_.resize(dirty.size());
+            for (std::size_t i = 0; i < dirty.size(); ++i) map_.snapshotTile(dirty[i], journalTiles_[i]);
+
+            long bytes = appendMapJournal(journalTiles_, journalName_);
+            if (bytes >= 0) {
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                std::cout << "Checkpoint: " << dirty.size() << " blocos em '" << journalName_
+                          << "' (" << us.count() << " us)." << std::endl;
+                journalBytes_ = bytes;
+            } else {
+                // Sem o journal o par mapa + journal ficaria incompleto: o próximo grava tudo
+                hasBase_ = false;
+            }
+        }
+    }
+    map_.releaseSnapshot();
+}
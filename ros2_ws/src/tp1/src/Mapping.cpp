@@ -1,18 +1,20 @@
 #include "Mapping.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "Globals.hpp"
+#include "SonarStencil.hpp"
+#include "LineTraversal.hpp"
+#include "SensorFrame.hpp"
+#include "WorkerPool.hpp"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <cmath>
 #include <iostream>
-#include <fstream>
-#include <unistd.h>
-#include <sstream>
+#include <thread>
 
-extern Position botPosition;
-extern std::vector<float> sonares;
-extern std::vector<std::vector<bool>> knownRegion;
+extern BitGrid knownRegion;
 
 std::vector<double> sensorAngles = {-90, -50, -30, -10, 10, 30, 50, 90, 90, 130, 150, 170, -170, -150, -130, -90};
 std::vector<int> sensorIndices = {0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 13, 14};
@@ -23,63 +25,47 @@ std::vector<Position> path;
 
 GridInfo grid = {-1.0f, 1.0f, 0.005f};
 int size = (grid.fim - grid.inicio) / grid.passo;
-std::vector<std::vector<float>> worldMatrix(size, std::vector<float>(size, 7.5f));
-std::vector<std::vector<int>> matrizPath(size, std::vector<int>(size, 0));
+// A pirâmide do mapa publica o máximo de cada bloco em view() para o campo potencial; a
+// quadtree e a pirâmide do desenho ficam na thread gráfica, montadas a partir de view()
+WorldMap worldMatrix(grid, 8, WorldMap::WITH_PYRAMID);
+OccupancyGrid<int> matrizPath(grid, 0);
+OccupancyGrid<float> logOddsMatrix(grid, 0.0f);
+
+std::atomic<MappingMode> mappingMode(MAP_HIMM);
+const float LOG_ODDS_MAX = 8.0f;
+SonarStencilCache sonarStencils;
+
+// Células tocadas pelo scan de laser em andamento; o carimbo do scan garante que cada
+// célula seja atualizada uma única vez, mesmo quando vários raios vizinhos passam por ela.
+// Fora da janela não há carimbo: essas células são juntadas em 'outside' e as repetidas descartadas.
+struct LaserScanBatch {
+    struct OutsideCell {
+        MatrixPosition pos;
+        bool hit;
+    };
+
+    OccupancyGrid<uint32_t> stamp;
+    uint32_t scan = 0;
+    std::vector<MatrixPosition> hits;
+    std::vector<MatrixPosition> frees;
+    std::vector<OutsideCell> outside;
+};
+LaserScanBatch laserBatch;
+
+// A região conhecida só cobre a janela densa
+void markKnown(const MatrixPosition& pos) {
+    if (knownRegion.isValid(pos)) knownRegion.setKnown(pos);
+}
 
 
 float round2(float valor) {
     return std::round(valor * 100.0f) / 100.0f;
 }
 
-void salvaMatriz(const std::vector<std::vector<float>>& matrix, const std::string& fileName) {
-    std::ofstream file(fileName);
-
-    if (!file.is_open()) {
-        std::cerr << "Erro ao acessar '" << fileName << "' para escrita." << std::endl;
-    } else {
-		for (const auto& line : matrix) {
-			for (const auto& value : line) {
-				file << value << " ";
-			}
-			file << "\n";
-		}
-
-		file.close();
-		std::cout << "Matriz salva em '" << fileName << "'." << std::endl;
-	}
-}
-
-std::vector<std::vector<float>> loadMatrix(const std::string& fileName) {
-    std::ifstream file(fileName);
-    std::vector<std::vector<float>> matrix;
-
-    if (!file.is_open()) {
-        std::cerr << "Erro ao acessar '" << fileName << "' para leitura." << std::endl;
-    } else {
-		std::string line;
-		while (std::getline(file, line)) {
-			std::istringstream stream(line);
-			std::vector<float> matrixLine;
-			float value;
-
-			while (stream >> value) {
-				matrixLine.push_back(value);
-			}
-
-			if (!matrixLine.empty()) {
-				matrix.push_back(matrixLine);
-			}
-		}
-
-		file.close();
-		std::cout << "Matriz carregada de '" << fileName << "'." << std::endl;
-	}
-    return matrix;
-}
-
 MatrixPosition findCell(float x, float y, float begin, float step) {
-    int column = static_cast<int>((x - begin) / step);
-    int line  = static_cast<int>((y - begin) / step);
+    // floor e não truncamento, como em traverseRay: um ponto logo antes da borda fica na célula -1
+    int column = static_cast<int>(std::floor((x - begin) / step));
+    int line  = static_cast<int>(std::floor((y - begin) / step));
 
     return {line, column};
 }
@@ -114,187 +100,433 @@ bool isValidPosition(const MatrixPosition& pos, int lines, int columns) {
             pos.coluna >= 0 && pos.coluna < columns);
 }
 
-float bayes(float R, float r, float s, float beta, float alpha, float max, float pOcup) {
+float bayesLogOdds(float R, float r, float s, float beta, float alpha, float max) {
 
     float RANGE = 0.01f;
-    float pOcupS = 0.5f;
+    float weight = 0.5f * ( (R-r)/R + (beta-std::abs(alpha))/beta ) * max;
+    weight = std::clamp(weight, 1.0f - max, max);
 
+    // Região I (em torno do retorno) só soma evidência de ocupação e a região II só de vazio,
+    // mesmo nas bordas do cone onde o peso do modelo cai abaixo de 0.5
     if ((r >= s - RANGE) && (r <= s + RANGE) && (s <= R)){
-        float pSOcup = 0.5f * ( (R-r)/R + (beta-std::abs(alpha))/beta ) * max;
-        float pSOcup_pOcup = pSOcup * pOcup;
-        pOcupS = (pSOcup_pOcup / (pSOcup_pOcup + ((1.0f - pSOcup) * (1 - pOcup))));
+        return std::max(0.0f, std::log(weight / (1.0f - weight)));
     }
-    else {
-        float pSVaz = 0.5f * ( (R-r)/R + (beta-std::abs(alpha))/beta ) * max;
-        float pSOcup_pOcup = (1.0f - pSVaz) * pOcup;
-        pOcupS = (pSOcup_pOcup / (pSOcup_pOcup + (pSVaz * (1 - pOcup))));
+    return std::min(0.0f, std::log((1.0f - weight) / weight));
+}
+
+void updateBayes(
+    OccupancyGrid<float>& logOdds,
+    WorldMap& matriz,
+    const Robot& robot,
+    float sensorAngle,
+    float maxRange = 2.0f
+) {
+    float R = maxRange * scaleFactor,
+        beta = robot.beta,
+        reach = std::min(R, static_cast<float>(robot.s) + 0.01f);
+
+    sonarStencils.configure(R, beta, matriz.info().passo);
+    const std::vector<StencilCell>& cone = sonarStencils.get(robot.pos.theta - sensorAngle);
+
+    for (const StencilCell& stencil : cone) {
+        if (stencil.distancia > reach) break;
+
+        MatrixPosition pos = {robot.gridPos.linha + stencil.dLinha, robot.gridPos.coluna + stencil.dColuna};
+        // O log-odds só existe na janela
+        if (!logOdds.isValid(pos)) continue;
+
+        float& cell = logOdds[pos];
+        cell = std::clamp(cell + bayesLogOdds(R, stencil.distancia, robot.s, beta, stencil.anguloRelativo, 0.98f),
+                          -LOG_ODDS_MAX, LOG_ODDS_MAX);
+
+        // worldMatrix segue na escala 0-15 do HIMM para o desenho e o campo potencial
+        matriz.set(pos, std::lround(15.0f * (1.0f - 1.0f / (1.0f + std::exp(cell)))));
+        markKnown(pos);
     }
+}
 
-    return pOcupS;
+// Geometria de um raio de sonar no HIMM: chama free(celula) para cada célula cruzada antes da
+// final e retorna a célula final; noDetect indica que nada foi visto até maxRange
+template <typename Visitor>
+MatrixPosition castHIMMRay(
+    const WorldMap& matrix,
+    const Robot& robot,
+    float sensorAngle,
+    float maxRange,
+    bool& noDetect,
+    Visitor&& free
+) {
+    float globalAngle = robot.pos.theta - sensorAngle;
+    noDetect = false;
+
+    float distance = robot.s;
+    if (distance > maxRange*scaleFactor) {
+        distance = maxRange*scaleFactor;
+        noDetect = true;
+    }
+
+    float xFinal = robot.mapPosition.x + cos(globalAngle) * distance;
+    float yFinal = robot.mapPosition.y + sin(globalAngle) * distance;
+
+    MatrixPosition occupied = matrix.findCell(xFinal, yFinal);
+    traverseRay(matrix.info(), robot.mapPosition.x, robot.mapPosition.y, xFinal, yFinal,
+        [&](const MatrixPosition& pos, float, float, bool last) {
+            if (last) {
+                occupied = pos;
+                return false;
+            }
+            free(pos);
+            return true;
+        });
+    return occupied;
 }
 
-void updateBayes(std::vector<std::vector<float>>& matriz, Robot robot, float sensorAngle) {
-    for (int line = 0; line < matriz.size(); ++line) {
-        for (int column = 0; column < matriz[0].size(); ++column) {
-            
-            MatrixPosition pos = {line, column};
-            CellCenter center = getCellCenter(pos, grid.inicio, grid.passo);
-
-            CellRelativeInfo relations = getRelativeInfo(
-                robot.cellCenter, 
-                center, 
-                robot.pos.theta - sensorAngle
-            );
-
-            float r = relations.distancia,
-				alpha = relations.anguloRelativo,
-				beta = robot.beta,
-				R = 2.0f;
-
-            if (r <= R * scaleFactor && (r <= robot.s + 0.01f) && alpha >= -beta && alpha <= beta) {
-                float pOcup = matriz[line][column];
-                matriz[line][column] = bayes(R, r, robot.s, beta, alpha, 0.98f, pOcup);
+// Retorno do sonar: a célula recebe a média ponderada da vizinhança 3x3 com 'add' no centro
+void applyHIMMHit(WorldMap& matrix, const MatrixPosition& occupied, int add) {
+    float sum = 0.0f;
+    float IMPORTANCE[3][3] = {
+        {0.5f, 0.5f, 0.5f},
+        {0.5f, 1.0f, 0.5f},
+        {0.5f, 0.5f, 0.5f}
+    };
+
+    for (int i = -1; i <= 1; ++i) {
+        for (int j = -1; j <= 1; ++j) {
+            float weight = IMPORTANCE[i + 1][j + 1];
+
+            if (i == 0 && j == 0) {
+                sum += add * weight;
+            } else {
+                sum += matrix.get(occupied.linha + i, occupied.coluna + j) * weight;
             }
         }
     }
-}
 
-std::vector<MatrixPosition> bresenham(MatrixPosition start, MatrixPosition end) {
-    std::vector<MatrixPosition> points;
+    matrix.set(occupied, std::lround(sum));
+}
 
-    int beginColumn = start.coluna,
-		beginLine = start.linha,
-		endColumn = end.coluna,
-		endLine = end.linha;
+void updateHIMM(
+    WorldMap& matrix,
+    const Robot& robot,
+    float sensorAngle,
+    float maxRange = 2.0f,
+    int add = 3,
+    int reduct = 1
+) {
+    bool noDetect;
+    MatrixPosition occupied = castHIMMRay(matrix, robot, sensorAngle, maxRange, noDetect,
+        [&](const MatrixPosition& pos) {
+            matrix.decrement(pos, reduct);
+            markKnown(pos);
+        });
+
+    if (!noDetect) {
+        applyHIMMHit(matrix, occupied, add);
+    } else {
+        matrix.decrement(occupied, reduct);
+    }
 
-    int dx = abs(endColumn - beginColumn),
-		dy = -abs(endLine - beginLine),
-		err = dx + dy;
+    markKnown(occupied);
+}
 
-    while (true) {
-        points.push_back({beginLine, beginColumn});
+// Raios de todos os sonares de uma leitura, integrados juntos por updateHIMMParallel
+struct SonarBatch {
+    struct Ray {
+        std::vector<MatrixPosition> frees;  // cruzadas pelo raio; inclui a final se nada foi visto
+        MatrixPosition occupied;
+        bool noDetect;
+    };
+    std::vector<Ray> rays;
+    std::vector<MatrixPosition> sensitive;
+    std::vector<WorldMap::CellDecrement> dense;
+    std::vector<int> tileStarts;
+};
+SonarBatch sonarBatch;
+WorkerPool mappingPool(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+std::atomic<bool> parallelMapping(false);
+
+bool positionBefore(const MatrixPosition& a, const MatrixPosition& b) {
+    return a.linha != b.linha ? a.linha < b.linha : a.coluna < b.coluna;
+}
 
-        if (beginColumn == endColumn && beginLine == endLine) break;
+// Mesmo resultado de chamar updateHIMM para cada sonar em sequência, com o trabalho dividido
+// entre as threads do pool: os raios são traçados em paralelo e os decrementos fora da vizinhança
+// 3x3 dos retornos, que ninguém lê e que comutam entre si, são aplicados em paralelo por bloco.
+// Só as células dessas vizinhanças são atualizadas em série, na ordem dos sonares.
+void updateHIMMParallel(
+    WorldMap& matrix,
+    Robot robot,
+    const std::vector<float>& sonars,
+    WorkerPool& pool,
+    float maxRange = 2.0f,
+    int add = 3,
+    int reduct = 1
+) {
+    std::vector<SonarBatch::Ray>& rays = sonarBatch.rays;
+    rays.resize(sensorIndices.size());
+
+    pool.run(static_cast<int>(rays.size()), [&](int k, int) {
+        int idx = sensorIndices[k];
+        Robot sensor = robot;
+        sensor.s = sonars[idx] * scaleFactor;
+        float sensorAngle = sensorAngles[idx] * M_PI / 180.0f;
+
+        SonarBatch::Ray& ray = rays[k];
+        ray.frees.clear();
+        ray.occupied = castHIMMRay(matrix, sensor, sensorAngle, maxRange, ray.noDetect,
+            [&](const MatrixPosition& pos) { ray.frees.push_back(pos); });
+        if (ray.noDetect) ray.frees.push_back(ray.occupied);
+    });
+
+    std::vector<MatrixPosition>& sensitive = sonarBatch.sensitive;
+    sensitive.clear();
+    for (const SonarBatch::Ray& ray : rays) {
+        if (ray.noDetect) continue;
+        for (int i = -1; i <= 1; ++i) {
+            for (int j = -1; j <= 1; ++j) sensitive.push_back({ray.occupied.linha + i, ray.occupied.coluna + j});
+        }
+    }
+    std::sort(sensitive.begin(), sensitive.end(), positionBefore);
+    sensitive.erase(std::unique(sensitive.begin(), sensitive.end(), [](const MatrixPosition& a, const MatrixPosition& b) {
+        return a.linha == b.linha && a.coluna == b.coluna;
+    }), sensitive.end());
+    auto isSensitive = [&](const MatrixPosition& pos) {
+        return std::binary_search(sensitive.begin(), sensitive.end(), pos, positionBefore);
+    };
+
+    // Decrementos livres: os da janela vão para os blocos em paralelo, os de fora são poucos
+    std::vector<WorldMap::CellDecrement>& dense = sonarBatch.dense;
+    dense.clear();
+    for (const SonarBatch::Ray& ray : rays) {
+        for (const MatrixPosition& pos : ray.frees) {
+            if (isSensitive(pos)) continue;
+            if (matrix.isDense(pos)) dense.push_back({pos, reduct});
+            else matrix.decrement(pos, reduct);
+        }
+    }
 
-        int e2 = 2 * err;
-        if (e2 >= dy) {
-            err += dy;
-            beginColumn += (beginColumn < endColumn) ? 1 : -1;
+    const int TILE = WorldMap::TILE;
+    std::sort(dense.begin(), dense.end(), [TILE](const WorldMap::CellDecrement& a, const WorldMap::CellDecrement& b) {
+        int ta = a.pos.linha / TILE, tb = b.pos.linha / TILE;
+        if (ta != tb) return ta < tb;
+        ta = a.pos.coluna / TILE, tb = b.pos.coluna / TILE;
+        if (ta != tb) return ta < tb;
+        return positionBefore(a.pos, b.pos);
+    });
+
+    // Junta as repetições de cada célula e marca o início de cada bloco
+    std::vector<int>& tileStarts = sonarBatch.tileStarts;
+    tileStarts.clear();
+    size_t merged = 0;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        if (merged > 0 && dense[merged - 1].pos.linha == dense[i].pos.linha
+            && dense[merged - 1].pos.coluna == dense[i].pos.coluna) {
+            dense[merged - 1].amount += dense[i].amount;
+            continue;
         }
-        if (e2 <= dx) {
-            err += dx;
-            beginLine += (beginLine < endLine) ? 1 : -1;
+        if (merged == 0 || dense[merged - 1].pos.linha / TILE != dense[i].pos.linha / TILE
+            || dense[merged - 1].pos.coluna / TILE != dense[i].pos.coluna / TILE) {
+            tileStarts.push_back(static_cast<int>(merged));
+        }
+        dense[merged++] = dense[i];
+    }
+    dense.resize(merged);
+    tileStarts.push_back(static_cast<int>(merged));
+    matrix.decrementTiles(dense, tileStarts, pool);
+
+    // Vizinhanças dos retornos, na ordem em que updateHIMM as atualizaria
+    for (const SonarBatch::Ray& ray : rays) {
+        for (const MatrixPosition& pos : ray.frees) {
+            if (isSensitive(pos)) matrix.decrement(pos, reduct);
         }
+        if (!ray.noDetect) applyHIMMHit(matrix, ray.occupied, add);
     }
 
-    return points;
+    for (const SonarBatch::Ray& ray : rays) {
+        for (const MatrixPosition& pos : ray.frees) markKnown(pos);
+        markKnown(ray.occupied);
+    }
 }
 
-void updateHIMM(
-    std::vector<std::vector<float>>& matrix,
+void updateLaserScan(
+    WorldMap& matrix,
     const Robot& robot,
-    float sensorAngle,
-    float maxRange = 2.0f,
-    float add = 3.0f,
-    float reduct = 1.0f,
-    float minValue = 0.0f,
-    float maxValue = 15.0f
+    const std::vector<float>& ranges,
+    float maxRange = 5.0f,
+    int add = 3,
+    int reduct = 1
 ) {
+    if (ranges.size() < 2) return;
 
-    float globalAngle = robot.pos.theta - sensorAngle;
-    bool noDetect = false;
+    if (laserBatch.stamp.rows() != matrix.rows() || laserBatch.stamp.cols() != matrix.cols()) {
+        laserBatch.stamp.reset(matrix.rows(), matrix.cols(), matrix.info(), 0u);
+        laserBatch.scan = 0;
+    }
+    if (++laserBatch.scan == 0) {
+        laserBatch.stamp.fill(0u);
+        laserBatch.scan = 1;
+    }
+    const uint32_t scan = laserBatch.scan;
+    laserBatch.hits.clear();
+    laserBatch.frees.clear();
+    laserBatch.outside.clear();
+
+    // Raios igualmente espaçados de -90 a 90 graus; o primeiro aponta para a esquerda do robô
+    float limit = maxRange * scaleFactor;
+    float increment = M_PI / (ranges.size() - 1);
+    float x0 = robot.mapPosition.x, y0 = robot.mapPosition.y;
+
+    // Retornos primeiro: uma célula ocupada não vira livre por um raio vizinho que a cruza
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        float distance = ranges[i] * scaleFactor;
+        if (distance >= limit) continue;
+
+        float globalAngle = robot.pos.theta + M_PI / 2.0f - i * increment;
+        MatrixPosition hit = matrix.findCell(x0 + cos(globalAngle) * distance, y0 + sin(globalAngle) * distance);
+        if (!laserBatch.stamp.isValid(hit)) {
+            laserBatch.outside.push_back({hit, true});
+            continue;
+        }
 
-    float distance = robot.s;
-    if (distance > maxRange*scaleFactor) {
-        distance = maxRange*scaleFactor;
-        noDetect = true;
+        uint32_t& mark = laserBatch.stamp[hit];
+        if (mark != scan) {
+            mark = scan;
+            laserBatch.hits.push_back(hit);
+        }
     }
 
-    float xFinal = robot.cellCenter.x + cos(globalAngle) * distance;
-    float yFinal = robot.cellCenter.y + sin(globalAngle) * distance;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        float distance = std::min(ranges[i] * scaleFactor, limit);
+        bool detected = ranges[i] * scaleFactor < limit;
 
-    MatrixPosition celulaFinal = findCell(xFinal, yFinal, grid.inicio, grid.passo);
-    if (!isValidPosition(celulaFinal, matrix.size(), matrix[0].size())) return;
+        float globalAngle = robot.pos.theta + M_PI / 2.0f - i * increment;
+        float xFinal = x0 + cos(globalAngle) * distance;
+        float yFinal = y0 + sin(globalAngle) * distance;
 
-    std::vector<MatrixPosition> path = bresenham(robot.gridPos, celulaFinal);
+        traverseRay(matrix.info(), x0, y0, xFinal, yFinal,
+            [&](const MatrixPosition& pos, float, float, bool last) {
+                if (last && detected) return false;
 
-    for (size_t i = 0; i + 1 < path.size(); ++i) {
-        float& cell = matrix[path[i].linha][path[i].coluna];
-        cell = std::max(minValue, cell - reduct);
-        knownRegion[path[i].linha][path[i].coluna] = true;
-    }
+                if (!laserBatch.stamp.isValid(pos)) {
+                    laserBatch.outside.push_back({pos, false});
+                    return true;
+                }
 
-    if (!path.empty()) {
-        MatrixPosition occupied = path.back();
-        float& cellCentral = matrix[occupied.linha][occupied.coluna];
-
-        if (!noDetect) {
-            float sum = 0.0f;
-            float IMPORTANCE[3][3] = {
-                {0.5f, 0.5f, 0.5f},
-                {0.5f, 1.0f, 0.5f},
-                {0.5f, 0.5f, 0.5f}
-            };
-
-            for (int i = -1; i <= 1; ++i) {
-                for (int j = -1; j <= 1; ++j) {
-                    int nextLine = occupied.linha + i;
-                    int nextColumn = occupied.coluna + j;
-
-                    if (isValidPosition({nextLine, nextColumn}, matrix.size(), matrix[0].size())) {
-                        float weight = IMPORTANCE[i + 1][j + 1];
-
-                        if (i == 0 && j == 0) {
-                            sum += add * weight;
-                        } else {
-                            sum += matrix[nextLine][nextColumn] * weight;
-                        }
-                    }
+                uint32_t& mark = laserBatch.stamp[pos];
+                if (mark != scan) {
+                    mark = scan;
+                    laserBatch.frees.push_back(pos);
                 }
-            }
+                return true;
+            });
+    }
 
-            cellCentral = std::min(maxValue, sum);
-        } else {
-            cellCentral = std::max(minValue, cellCentral - reduct);
-        }
+    for (const MatrixPosition& pos : laserBatch.frees) {
+        matrix.decrement(pos, reduct);
+        markKnown(pos);
+    }
+    for (const MatrixPosition& pos : laserBatch.hits) {
+        matrix.increment(pos, add);
+        markKnown(pos);
+    }
 
-        knownRegion[occupied.linha][occupied.coluna] = true;
+    if (laserBatch.outside.empty()) return;
+
+    // Ordena por célula com os retornos na frente, então 'unique' mantém o retorno quando
+    // a mesma célula também foi cruzada por outro raio
+    std::vector<LaserScanBatch::OutsideCell>& outside = laserBatch.outside;
+    std::sort(outside.begin(), outside.end(), [](const LaserScanBatch::OutsideCell& a, const LaserScanBatch::OutsideCell& b) {
+        if (a.pos.linha != b.pos.linha) return a.pos.linha < b.pos.linha;
+        if (a.pos.coluna != b.pos.coluna) return a.pos.coluna < b.pos.coluna;
+        return a.hit > b.hit;
+    });
+    auto end = std::unique(outside.begin(), outside.end(), [](const LaserScanBatch::OutsideCell& a, const LaserScanBatch::OutsideCell& b) {
+        return a.pos.linha == b.pos.linha && a.pos.coluna == b.pos.coluna;
+    });
+
+    for (auto it = outside.begin(); it != end; ++it) {
+        if (it->hit) matrix.increment(it->pos, add);
+        else matrix.decrement(it->pos, reduct);
     }
 }
 
 
+// Quadros do laço de controle para as threads de mapeamento, campo potencial e gráficos
+SensorFeed sensorFeed;
+
 void* mappingThreadFunction(void* arg) {
+    uint32_t processedSonar = 0, processedLaser = 0;
+    bool laserWasUsed = false;
+    unsigned long frames = 0, superseded = 0;
+    auto reportStart = std::chrono::steady_clock::now();
+
     while (rclcpp::ok()) {
-        MatrixPosition botMatrix = findCell(botPosition.x * scaleFactor - offset[0], 
-                                              botPosition.y * scaleFactor - offset[1], 
-                                              grid.inicio, grid.passo);
-        
-        int lines = worldMatrix.size(),
-			columns = worldMatrix[0].size();
+        // Entre duas leituras o mapa está consistente: um snapshot pedido começa aqui
+        worldMatrix.syncPoint();
+
+        // O tempo limite mantém o syncPoint e o fim do programa andando quando não chegam quadros
+        if (!sensorFeed.wait(SensorFeed::MAPPING, 100)) continue;
+
+        const SensorFrame& frame = sensorFeed.latest(SensorFeed::MAPPING);
+
+        // O modo é lido uma vez por quadro, para um quadro não ser integrado metade em cada modo
+        MappingMode mode = mappingMode.load();
 
-        if (isValidPosition(botMatrix, lines, columns) && !sonares.empty()) {
+        // A pose é publicada a cada ciclo; só uma leitura nova do sensor que o modo usa é mapeada.
+        // Leituras que chegaram e foram substituídas antes de a thread pegá-las entram no relatório.
+        uint32_t& processed = mode == MAP_LASER ? processedLaser : processedSonar;
+        uint32_t sequence = mode == MAP_LASER ? frame.laserSequence : frame.sonarSequence;
+        if (sequence == processed) continue;
+        // Logo depois de trocar de sensor o salto desde a última leitura usada não conta
+        if (processed != 0 && laserWasUsed == (mode == MAP_LASER)) superseded += sequence - processed - 1;
+        processed = sequence;
+        laserWasUsed = mode == MAP_LASER;
 
-            CellCenter botCenterCell = getCellCenter(botMatrix, grid.inicio, grid.passo);
-            Robot robotInfo = {botMatrix, botPosition, botCenterCell, 0.0f};
+        // Os raios partem da pose no instante da leitura de cada sensor
+        const Position& pose = mode == MAP_LASER ? frame.laserPose : frame.sonarPose;
+        CellCenter botMapPosition = {pose.x * scaleFactor - offset[0],
+                                     pose.y * scaleFactor - offset[1]};
+        MatrixPosition botMatrix = worldMatrix.findCell(botMapPosition.x, botMapPosition.y);
+
+        // O mapa não tem borda: fora da janela as células vão para blocos esparsos
+        const std::vector<float>& readings = mode == MAP_LASER ? frame.lasers : frame.sonars;
+        if (!readings.empty() && !knownRegion.empty()) {
+
+            CellCenter botCenterCell = worldMatrix.getCellCenter(botMatrix);
+            Robot robotInfo = {botMatrix, pose, botCenterCell, botMapPosition, 0.0f};
 
             // Bayes
-            if(false){
+            if(mode == MAP_BAYES){
                 for (int idx : sensorIndices) {
                     float sensorAngle = sensorAngles[idx] * M_PI / 180.0f;
-                    robotInfo.s = sonares[idx] * scaleFactor;
-                    updateBayes(worldMatrix, robotInfo, sensorAngle); // Bayes
+                    robotInfo.s = frame.sonars[idx] * scaleFactor;
+                    updateBayes(logOddsMatrix, worldMatrix, robotInfo, sensorAngle); // Bayes
                 }
+            }else if(mode == MAP_LASER){
+                updateLaserScan(worldMatrix, robotInfo, frame.lasers);
+            }else if(parallelMapping.load()){
+                updateHIMMParallel(worldMatrix, robotInfo, frame.sonars, mappingPool);
             }else{
             // HIMM
                 for (int idx : sensorIndices) {
-                    robotInfo.s = sonares[idx] * scaleFactor;
+                    robotInfo.s = frame.sonars[idx] * scaleFactor;
                     float sensorAngle = sensorAngles[idx] * M_PI / 180.0f;
                     updateHIMM(worldMatrix, robotInfo, sensorAngle);
                 }
             }
         }
-
-        usleep(10000);
+        worldMatrix.publishView();
+        ++frames;
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - reportStart).count();
+        if (seconds >= 10.0) {
+            std::cout << "Mapeamento: " << frames / seconds << " quadros/s, "
+                      << superseded << " leituras substituídas antes de mapear" << std::endl;
+            frames = 0;
+            superseded = 0;
+            reportStart = now;
+        }
     }
     return NULL;
-}
\ No newline at end of file
+}
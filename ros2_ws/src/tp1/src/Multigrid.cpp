@@ -0,0 +1,194 @@
+#include "Multigrid.hpp"
+#include "Stencil.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Varreduras de Gauss-Seidel antes e depois da correção, e no nível mais grosso
+const int PRE_SWEEPS = 2;
+const int POST_SWEEPS = 2;
+const int COARSE_SWEEPS = 40;
+const int COARSEST_SIZE = 4;
+
+}
+
+void LaplaceMultigrid::build(const OccupancyGrid<float>& field, const OccupancyGrid<uint8_t>& fixed)
+{
+    if (levels_.empty() || levels_[0].rows != field.rows() || levels_[0].cols != field.cols()) {
+        levels_.clear();
+        int rows = field.rows(), cols = field.cols();
+        while (true) {
+            Level level;
+            level.rows = rows;
+            level.cols = cols;
+            GridInfo none = {0.0f, static_cast<float>(cols + 2), 1.0f};
+            level.value.reset(rows + 2, cols + 2, none, 0.0f);
+            level.rhs.reset(rows + 2, cols + 2, none, 0.0f);
+            level.residual.reset(rows + 2, cols + 2, none, 0.0f);
+            level.fixed.reset(rows + 2, cols + 2, none, 1);
+            levels_.push_back(std::move(level));
+
+            if (std::min(rows, cols) <= COARSEST_SIZE) break;
+            rows = (rows + 1) / 2;
+            cols = (cols + 1) / 2;
+        }
+    }
+
+    // Nível 0: o campo e a máscara, deslocados de uma célula por causa da borda
+    Level& top = levels_[0];
+    for (int y = 0; y < top.rows; ++y) {
+        std::memcpy(top.value.row(y + 1) + 1, field.row(y), top.cols * sizeof(float));
+        std::memcpy(top.fixed.row(y + 1) + 1, fixed.row(y), top.cols);
+    }
+
+    // Nos níveis grossos uma célula é fixa se qualquer uma das quatro filhas for (as de fora da
+    // grade fina caem na borda, que é fixa). Exigir as quatro deixa paredes finas "vazarem" na
+    // correção grossa e o V-ciclo diverge.
+    for (size_t k = 1; k < levels_.size(); ++k) {
+        const Level& fine = levels_[k - 1];
+        Level& coarse = levels_[k];
+        for (int y = 0; y < coarse.rows; ++y) {
+            uint8_t* mask = coarse.fixed.row(y + 1) + 1;
+            const uint8_t* fine0 = fine.fixed.row(2 * y + 1) + 1;
+            const uint8_t* fine1 = fine.fixed.row(2 * y + 2) + 1;
+            for (int x = 0; x < coarse.cols; ++x) {
+                mask[x] = fine0[2 * x] | fine0[2 * x + 1] | fine1[2 * x] | fine1[2 * x + 1];
+            }
+        }
+    }
+}
+
+int LaplaceMultigrid::solve(OccupancyGrid<float>& field, const OccupancyGrid<uint8_t>& fixed, float tolerance, int maxCycles)
+{
+    if (field.empty()) return 0;
+    build(field, fixed);
+
+    Level& top = levels_[0];
+    top.rhs.fill(0.0f);
+
+    int cycles = 0;
+    residual_ = computeResidual(top);
+    while (residual_ > tolerance && cycles < maxCycles) {
+        cycle(0);
+        residual_ = computeResidual(top);
+        ++cycles;
+    }
+
+    for (int y = 0; y < top.rows; ++y) {
+        std::memcpy(field.row(y), top.value.row(y + 1) + 1, top.cols * sizeof(float));
+    }
+    return cycles;
+}
+
+void LaplaceMultigrid::cycle(int k)
+{
+    Level& level = levels_[k];
+    if (k + 1 == static_cast<int>(levels_.size())) {
+        smooth(level, COARSE_SWEEPS);
+        return;
+    }
+
+    smooth(level, PRE_SWEEPS);
+    computeResidual(level);
+
+    Level& coarse = levels_[k + 1];
+    restrict(level, coarse);
+    coarse.value.fill(0.0f);
+    cycle(k + 1);
+    prolong(coarse, level);
+
+    smooth(level, POST_SWEEPS);
+}
+
+void LaplaceMultigrid::smooth(Level& level, int sweeps)
+{
+    // Gauss-Seidel vermelho-preto de 4u - vizinhos = rhs. Numa cor cada faixa só escreve as suas
+    // células e só lê vizinhos da outra cor, inclusive nas linhas de borda das faixas vizinhas, que
+    // ninguém escreve nessa meia varredura; a troca de bordas entre as faixas é só a espera do
+    // run() entre uma cor e outra.
+    const StencilKernels& kernels = stencilKernels();
+    for (int sweep = 0; sweep < sweeps; ++sweep) {
+        for (int color = 0; color < 2; ++color) {
+            forEachBand(level.rows, [&](int begin, int end, int) {
+                for (int y = begin + 1; y <= end; ++y) {
+                    kernels.smoothRow(level.value.row(y), level.value.row(y - 1), level.value.row(y + 1),
+                                      level.rhs.row(y), level.fixed.row(y), 1, level.cols + 1, (y + color) & 1);
+                }
+            });
+        }
+    }
+}
+
+float LaplaceMultigrid::computeResidual(Level& level)
+{
+    // Máximo de cada faixa em partial_, depois o máximo entre as faixas
+    const StencilKernels& kernels = stencilKernels();
+    partial_.assign(bands(level.rows), 0.0f);
+    forEachBand(level.rows, [&](int begin, int end, int band) {
+        float largest = 0.0f;
+        for (int y = begin + 1; y <= end; ++y) {
+            largest = std::max(largest, kernels.residualRow(level.residual.row(y), level.value.row(y),
+                                                            level.value.row(y - 1), level.value.row(y + 1),
+                                                            level.rhs.row(y), level.fixed.row(y), 1, level.cols + 1));
+        }
+        partial_[band] = largest;
+    });
+    return *std::max_element(partial_.begin(), partial_.end());
+}
+
+void LaplaceMultigrid::restrict(const Level& fine, Level& coarse)
+{
+    // Com passo 2h o lado direito grosso é 4 vezes a média dos resíduos, ou seja, a soma deles.
+    // Filhas fora da grade fina caem na borda de zeros.
+    forEachBand(coarse.rows, [&](int begin, int end, int) {
+        for (int y = begin; y < end; ++y) {
+            const float* r0 = fine.residual.row(2 * y + 1);
+            const float* r1 = fine.residual.row(2 * y + 2);
+            const uint8_t* mask = coarse.fixed.row(y + 1);
+            float* f = coarse.rhs.row(y + 1);
+
+            for (int x = 0; x < coarse.cols; ++x) {
+                f[x + 1] = mask[x + 1] ? 0.0f : r0[2 * x + 1] + r0[2 * x + 2] + r1[2 * x + 1] + r1[2 * x + 2];
+            }
+        }
+    });
+}
+
+void LaplaceMultigrid::prolong(const Level& coarse, Level& fine)
+{
+    // Interpolação bilinear entre centros de células: 9/16 da célula grossa que contém a fina,
+    // 3/16 de cada vizinha do lado da fina e 1/16 da diagonal
+    forEachBand(fine.rows, [&](int begin, int end, int) {
+        for (int y = begin; y < end; ++y) {
+            int Y = y / 2 + 1, dy = (y & 1) ? 1 : -1;
+            const float* c0 = coarse.value.row(Y);
+            const float* c1 = coarse.value.row(Y + dy);
+            float* u = fine.value.row(y + 1);
+            const uint8_t* mask = fine.fixed.row(y + 1);
+
+            for (int x = 0; x < fine.cols; ++x) {
+                if (mask[x + 1]) continue;
+                int X = x / 2 + 1, dx = (x & 1) ? 1 : -1;
+                u[x + 1] += 0.5625f * c0[X] + 0.1875f * (c0[X + dx] + c1[X]) + 0.0625f * c1[X + dx];
+            }
+        }
+    });
+}
+
+int LaplaceMultigrid::bands(int rows) const
+{
+    if (!pool_) return 1;
+    return pool_->bands(rows, pool_->bandRows(rows));
+}
+
+void LaplaceMultigrid::forEachBand(int rows, const std::function<void(int, int, int)>& band)
+{
+    if (!pool_) {
+        band(0, rows, 0);
+        return;
+    }
+    pool_->runBands(rows, pool_->bandRows(rows), band);
+}
@@ -4,6 +4,25 @@
 #include <cstring>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.hpp>
 
+namespace {
+
+double stampSeconds(const builtin_interfaces::msg::Time& stamp)
+{
+    return stamp.sec + stamp.nanosec * 1e-9;
+}
+
+float yawOf(const geometry_msgs::msg::Quaternion& q)
+{
+    tf2::Quaternion tf_quat;
+    tf2::fromMsg(q, tf_quat);
+
+    double roll, pitch, yaw;
+    tf2::Matrix3x3(tf_quat).getRPY(roll, pitch, yaw);
+    return static_cast<float>(yaw);
+}
+
+}
+
 Perception::Perception()
 {
 }
@@ -67,6 +86,7 @@ void Perception::receiveLaser(const sensor_msgs::msg::LaserScan::ConstSharedPtr
     //                          # the array empty.
     laserROS.ranges = value->ranges;
     laserROS.intensities = value->intensities;
+    ++laserSequence;
 }
 
 void Perception::receiveSonar(const sensor_msgs::msg::PointCloud2::ConstSharedPtr &value)
@@ -123,6 +143,7 @@ void Perception::receiveSonar(const sensor_msgs::msg::PointCloud2::ConstSharedPt
 
     // bool is_dense        # True if there are no invalid points
     sonarROS.is_dense = value->is_dense;
+    ++sonarSequence;
 }
 
 void Perception::recievePose(const nav_msgs::msg::Odometry::ConstSharedPtr &value)
@@ -131,6 +152,39 @@ void Perception::recievePose(const nav_msgs::msg::Odometry::ConstSharedPtr &valu
     poseROS.pose.pose.position.x = value->pose.pose.position.x;
     poseROS.pose.pose.position.y = value->pose.pose.position.y;
     poseROS.pose.pose.orientation = value->pose.pose.orientation;
+
+    poseHistory.push({stampSeconds(value->header.stamp),
+                      static_cast<float>(value->pose.pose.position.x),
+                      static_cast<float>(value->pose.pose.position.y),
+                      yawOf(value->pose.pose.orientation)});
+}
+
+uint32_t Perception::getSonarSequence()
+{
+    return sonarSequence;
+}
+
+uint32_t Perception::getLaserSequence()
+{
+    return laserSequence;
+}
+
+double Perception::getLatestSonarStamp()
+{
+    return stampSeconds(sonarROS.header.stamp);
+}
+
+double Perception::getLatestLaserStamp()
+{
+    return stampSeconds(laserROS.header.stamp);
+}
+
+std::vector<float> Perception::getPoseAt(double stamp)
+{
+    if (poseHistory.empty()) return {};
+
+    StampedPose pose = poseHistory.at(stamp);
+    return {pose.x, pose.y, pose.theta};
 }
 
 std::vector<float> Perception::getLatestLaserRanges()
@@ -178,16 +232,9 @@ std::vector<float> Perception::getLatestSonarRanges()
 std::vector<float>  Perception::getLatestPose(){
     float x = poseROS.pose.pose.position.x;
     float y = poseROS.pose.pose.position.y;
+    float yaw = yawOf(poseROS.pose.pose.orientation);
 
-    geometry_msgs::msg::Quaternion q = poseROS.pose.pose.orientation;
-
-    tf2::Quaternion tf_quat;
-    tf2::fromMsg(q, tf_quat);
-    
-    double roll, pitch, yaw;
-    tf2::Matrix3x3(tf_quat).getRPY(roll, pitch, yaw);
-
-    std::vector<float> pose = {x, y, static_cast<float>(yaw)};
+    std::vector<float> pose = {x, y, yaw};
 
     std::cout << "x: " << x << ", y: " << y << ", yaw: " << yaw << std::endl;
 
@@ -1,82 +1,272 @@
 #include "Mapping.hpp"
+#include "SensorFrame.hpp"
+#include "Multigrid.hpp"
+#include "Stencil.hpp"
+#include "WorkerPool.hpp"
 #include "rclcpp/rclcpp.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
-extern std::vector<std::vector<float>> worldMatrix;
+extern WorldMap worldMatrix;
 extern std::vector<float> offset;
 extern float scaleFactor;
-extern Position botPosition;
+extern SensorFeed sensorFeed;
 extern GridInfo grid;
 
-std::vector<std::vector<float>> potentialField;
-std::vector<std::vector<bool>> knownRegion;
+OccupancyGrid<float> potentialField;
+BitGrid knownRegion;
 
-void initMatrixes() {
-    size_t lines = worldMatrix.size();
-    size_t columns = lines > 0 ? worldMatrix[0].size() : 0;
+// Threads da relaxação: as varreduras são divididas em faixas de linhas, uma por núcleo
+WorkerPool fieldPool(std::max(1u, std::thread::hardware_concurrency()));
 
-    knownRegion.resize(lines);
-    potentialField.resize(lines);
+// Campo inteiro por multigrid a cada ciclo (senão, SOR só na janela em volta do robô)
+std::atomic<bool> fullFieldSolve(true);
+OccupancyGrid<uint8_t> fieldFixed;
+LaplaceMultigrid fieldSolver(&fieldPool);
 
-    for (size_t i = 0; i < lines; ++i) {
-        knownRegion[i].resize(columns, false);
-        potentialField[i].resize(columns, 0.0f);
-    }
+void initMatrixes() {
+    // Só a janela do grid (o mapa do mundo pode ir além dela)
+    potentialField.reset(grid, 0.0f);
+    knownRegion.reset(potentialField.rows(), potentialField.cols(), grid);
+    fieldFixed.reset(potentialField.rows(), potentialField.cols(), grid, 1);
 } 
 
-void updatePotentialField() {
-	for (size_t y = 0; y < knownRegion.size(); ++y) {
-		for (size_t x = 0; x < knownRegion[y].size(); ++x) {
-			if (knownRegion[y][x] && worldMatrix[y][x] > 10.0f) {
-				potentialField[y][x] = 1.0f;
+// Região do campo em células, [yStart, yEnd) x [xStart, xEnd)
+struct FieldRegion {
+	int yStart = 0, yEnd = 0, xStart = 0, xEnd = 0;
+
+	bool empty() const { return yStart >= yEnd || xStart >= xEnd; }
+};
+
+// Última versão do mapa já passada para o campo; os blocos escritos depois dela estão sujos
+uint64_t fieldMapVersion = 0;
+
+// Marca os obstáculos só nos blocos do mapa que mudaram desde a última versão vista e retorna a
+// região do campo que eles cobrem (vazia se nada mudou). Uma célula que passa a ser conhecida é
+// escrita no mapa na mesma leitura, então o bloco dela também aparece como sujo.
+FieldRegion updatePotentialField() {
+	FieldRegion changed;
+
+	// Versão publicada do mapa: a thread de mapeamento continua escrevendo na grade viva
+	std::shared_ptr<const WorldMap::MapView> view = worldMatrix.view();
+	if (view->version == fieldMapVersion) return changed;
+
+	const int TILE = WorldMap::TILE;
+	int tileColumns = view->cells.cols() / TILE;
+	changed = {potentialField.rows(), 0, potentialField.cols(), 0};
+
+	for (size_t t = 0; t < view->tileVersion.size(); ++t) {
+		if (view->tileVersion[t] <= fieldMapVersion) continue;
+
+		int yStart = static_cast<int>(t) / tileColumns * TILE,
+			xStart = static_cast<int>(t) % tileColumns * TILE;
+		int yEnd = std::min(yStart + TILE, potentialField.rows()),
+			xEnd = std::min(xStart + TILE, potentialField.cols());
+		if (yStart >= yEnd || xStart >= xEnd) continue;  // bloco fora da janela do campo
+
+		// Pelo máximo do bloco (pirâmide do mapa), os blocos livres nem têm as células lidas;
+		// a região alterada inclui o bloco de qualquer jeito, por causa das células conhecidas
+		bool obstacles = view->tileMax.empty() || view->tileMax[t] > 10;
+		for (int y = yStart; obstacles && y < yEnd; ++y) {
+			float* field = potentialField.row(y);
+			for (int x = xStart; x < xEnd; ++x) {
+				if (knownRegion.get(y, x) && view->cells.get(y, x) > 10) field[x] = 1.0f;
 			}
 		}
+		changed.yStart = std::min(changed.yStart, yStart);
+		changed.yEnd = std::max(changed.yEnd, yEnd);
+		changed.xStart = std::min(changed.xStart, xStart);
+		changed.xEnd = std::max(changed.xEnd, xEnd);
 	}
+
+	fieldMapVersion = view->version;
+	return changed;
 }
 
-void updatePotentialField(int xStart, int xEnd, int yStart, int yEnd, float epsilon) {
-	std::vector<std::vector<float>> updatedField = potentialField;
+// Fator de sobre-relaxação do SOR, em (0, 2); 0 usa o ótimo teórico para o tamanho da janela
+std::atomic<float> sorOmega(0.0f);
+
+// Sobre-relaxação vermelho-preto (SOR) no próprio campo, só dentro da janela: primeiro as
+// células com x + y par, depois as ímpares, cada metade já usando os valores novos da outra.
+// O erro é o mesmo do Jacobi (soma dos quadrados das correções de Gauss-Seidel).
+// A janela é dividida em faixas de linhas no fieldPool, uma por thread (ver WorkerPool::bandRows),
+// cada uma somando o seu erro à parte; as faixas só leem as linhas de borda das vizinhas na
+// outra cor (ver LaplaceMultigrid::smooth).
+// Retorna o número de varreduras (0 se a janela estiver vazia).
+int updatePotentialField(int xStart, int xEnd, int yStart, int yEnd, float epsilon, float omega) {
+	// O mapa não tem borda: com o robô a RADIUS células ou mais fora do campo não sobra janela
+	if (xEnd < xStart || yEnd < yStart) return 0;
+
+	const int MAX_ITERATIONS = 10000;
+	int rows = yEnd - yStart + 1,
+		minRows = fieldPool.bandRows(rows);
+	std::vector<float> partial(fieldPool.bands(rows, minRows));
+	const StencilKernels& kernels = stencilKernels();
+
+	int iterations = 0;
 	float error;
 	do {
-		error = 0.0f;
-
-        for (int y = yStart; y <= yEnd; ++y) {
-            for (int x = xStart; x <= xEnd; ++x) {
-                if (potentialField[y][x] != 1.0f) {
-                    float newValue = 0.25f * (
-                        potentialField[y - 1][x] +
-                        potentialField[y + 1][x] +
-                        potentialField[y][x - 1] +
-                        potentialField[y][x + 1]
-                    );
-
-                    error += std::pow(potentialField[y][x] - newValue, 2);
-                    updatedField[y][x] = newValue;
-                }
-            }
-        }
-        potentialField = updatedField;
-	} while (error > epsilon);
+		std::fill(partial.begin(), partial.end(), 0.0f);
+
+		for (int color = 0; color < 2; ++color) {
+			fieldPool.runBands(rows, minRows, [&](int begin, int end, int band) {
+				float bandError = 0.0f;
+				for (int y = yStart + begin; y < yStart + end; ++y) {
+					bandError += kernels.sorRow(potentialField.row(y), potentialField.row(y - 1), potentialField.row(y + 1),
+												xStart, xEnd + 1, (y + color) & 1, omega);
+				}
+				partial[band] += bandError;
+			});
+		}
+		error = std::accumulate(partial.begin(), partial.end(), 0.0f);
+		++iterations;
+	} while (error > epsilon && iterations < MAX_ITERATIONS);
+
+	return iterations;
 }
 
 void convertField(float epsilon) {
     if (!potentialField.empty()) {
-		size_t lines = potentialField.size(),
-			columns = potentialField[0].size();
+		int lines = potentialField.rows(),
+			columns = potentialField.cols();
 
+		const Position& botPosition = sensorFeed.latest(SensorFeed::FIELD).pose;
 		float xPosition = botPosition.x * scaleFactor + offset[0];
 		float yPosition = botPosition.y * scaleFactor + offset[1];
-		MatrixPosition matPos = findCell(xPosition, yPosition, grid.inicio, grid.passo);
+		MatrixPosition matPos = potentialField.findCell(xPosition, yPosition);
 
 		int RADIUS = 20;
 		int xStart = std::max(1, matPos.coluna - RADIUS);
-		int xEnd = std::min((int)columns - 2, matPos.coluna + RADIUS);
+		int xEnd = std::min(columns - 2, matPos.coluna + RADIUS);
 		int yStart = std::max(1, matPos.linha - RADIUS);
-		int yEnd = std::min((int)lines - 2, matPos.linha + RADIUS);
+		int yEnd = std::min(lines - 2, matPos.linha + RADIUS);
+		if (xEnd < xStart || yEnd < yStart) return;
 
-		updatePotentialField(xStart, xEnd, yStart, yEnd, epsilon);
+		// Ótimo para o problema modelo numa janela quadrada de n células: 2 / (1 + sin(pi / (n + 1)))
+		float omega = sorOmega.load();
+		if (omega <= 0.0f) {
+			int n = std::max(xEnd - xStart, yEnd - yStart) + 1;
+			omega = 2.0f / (1.0f + std::sin(M_PI / (n + 1)));
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		int iterations = updatePotentialField(xStart, xEnd, yStart, yEnd, epsilon, omega);
+		auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+		// Média a cada 25 soluções (~5 s)
+		static int solves = 0;
+		static long totalIterations = 0, totalMicros = 0;
+		totalIterations += iterations;
+		totalMicros += us.count();
+		if (++solves == 25) {
+			std::cout << "Campo potencial (SOR " << stencilKernels().name << ", w=" << omega << "): " << totalIterations / solves
+					  << " iterações, " << totalMicros / solves << " us por solução" << std::endl;
+			solves = 0;
+			totalIterations = totalMicros = 0;
+		}
+	}
+}
+
+// Máscara do campo harmônico numa região: obstáculos (1) e células desconhecidas (0, a fronteira
+// de exploração que atrai o robô) ficam fixos e só as células conhecidas e livres são resolvidas
+void updateFieldMask(const FieldRegion& region) {
+	for (int y = region.yStart; y < region.yEnd; ++y) {
+		float* field = potentialField.row(y);
+		uint8_t* fixed = fieldFixed.row(y);
+		std::fill(fixed + region.xStart, fixed + region.xEnd, 1);
+		knownRegion.forEachSpan(y, [&](int begin, int end) {
+			for (int x = std::max(begin, region.xStart); x < std::min(end, region.xEnd); ++x) {
+				fixed[x] = field[x] == 1.0f;
+			}
+		});
+		for (int x = region.xStart; x < region.xEnd; ++x) {
+			if (fixed[x] && field[x] != 1.0f) field[x] = 0.0f;
+		}
+	}
+}
+
+// Solução local: um quadrado de LOCAL_SIZE células com pelo menos LOCAL_MARGIN em volta da região
+// alterada, com a borda presa nos valores atuais do campo. Depois de FULL_EVERY soluções locais a
+// grade inteira é resolvida de novo, para espalhar o que as bordas presas seguraram.
+const int LOCAL_SIZE = 128;
+const int LOCAL_MARGIN = 32;
+const int FULL_EVERY = 25;
+OccupancyGrid<float> localField;
+OccupancyGrid<uint8_t> localFixed;
+LaplaceMultigrid localSolver(&fieldPool);
+
+int solveLocal(const FieldRegion& changed, float tolerance) {
+	int rows = potentialField.rows(),
+		columns = potentialField.cols();
+	int yStart = std::clamp((changed.yStart + changed.yEnd - LOCAL_SIZE) / 2, 0, rows - LOCAL_SIZE);
+	int xStart = std::clamp((changed.xStart + changed.xEnd - LOCAL_SIZE) / 2, 0, columns - LOCAL_SIZE);
+
+	if (localField.rows() != LOCAL_SIZE) {
+		GridInfo none = {0.0f, static_cast<float>(LOCAL_SIZE), 1.0f};
+		localField.reset(LOCAL_SIZE, LOCAL_SIZE, none, 0.0f);
+		localFixed.reset(LOCAL_SIZE, LOCAL_SIZE, none, 1);
+	}
+
+	// Na borda da grade não há o que prender: lá o campo inteiro também vê zeros do lado de fora
+	bool top = yStart > 0, bottom = yStart + LOCAL_SIZE < rows,
+		 left = xStart > 0, right = xStart + LOCAL_SIZE < columns;
+	for (int y = 0; y < LOCAL_SIZE; ++y) {
+		uint8_t* fixed = localFixed.row(y);
+		std::memcpy(localField.row(y), potentialField.row(yStart + y) + xStart, LOCAL_SIZE * sizeof(float));
+		std::memcpy(fixed, fieldFixed.row(yStart + y) + xStart, LOCAL_SIZE);
+		if ((y == 0 && top) || (y == LOCAL_SIZE - 1 && bottom)) std::fill(fixed, fixed + LOCAL_SIZE, 1);
+		if (left) fixed[0] = 1;
+		if (right) fixed[LOCAL_SIZE - 1] = 1;
+	}
+
+	int cycles = localSolver.solve(localField, localFixed, tolerance, 30);
+	for (int y = 0; y < LOCAL_SIZE; ++y) {
+		std::memcpy(potentialField.row(yStart + y) + xStart, localField.row(y), LOCAL_SIZE * sizeof(float));
+	}
+	return cycles;
+}
+
+// Campo harmônico na grade inteira, atualizado só onde o mapa mudou: a máscara é refeita na
+// região alterada e a solução anterior é o ponto de partida. Mudanças pequenas são resolvidas
+// num quadrado em volta delas; as grandes (ou a primeira) pela grade inteira.
+void solveField(const FieldRegion& changed, float tolerance) {
+	if (potentialField.empty() || changed.empty()) return;
+
+	updateFieldMask(changed);
+
+	static int localSolves = 0;
+	bool local = localSolves < FULL_EVERY
+			  && changed.yEnd - changed.yStart + 2 * LOCAL_MARGIN <= LOCAL_SIZE
+			  && changed.xEnd - changed.xStart + 2 * LOCAL_MARGIN <= LOCAL_SIZE
+			  && LOCAL_SIZE <= std::min(potentialField.rows(), potentialField.cols());
+
+	auto start = std::chrono::steady_clock::now();
+	int cycles = local ? solveLocal(changed, tolerance)
+					   : fieldSolver.solve(potentialField, fieldFixed, tolerance, 30);
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	localSolves = local ? localSolves + 1 : 0;
+
+	// Média a cada 25 soluções
+	static int solves = 0, locals = 0;
+	static long totalCycles = 0, totalMicros = 0;
+	totalCycles += cycles;
+	totalMicros += us.count();
+	locals += local;
+	if (++solves == 25) {
+		std::cout << "Campo potencial (multigrid " << stencilKernels().name << "): " << locals << " de " << solves
+				  << " soluções locais, " << static_cast<float>(totalCycles) / solves << " V-ciclos, "
+				  << totalMicros / solves << " us por solução, resíduo "
+				  << (local ? localSolver : fieldSolver).residual() << std::endl;
+		solves = locals = 0;
+		totalCycles = totalMicros = 0;
 	}
 }
 
@@ -84,9 +274,19 @@ void* potentialFieldThreadFunction(void* arg) {
 
     initMatrixes();
 
+    // O SOR na janela não mantém a máscara do multigrid: ao voltar para ele a grade inteira é refeita
+    bool fieldSolved = false;
+
     while (rclcpp::ok()) {
-		updatePotentialField();
-        convertField(0.2f);
+		FieldRegion changed = updatePotentialField();
+		if (fullFieldSolve.load()) {
+			if (!fieldSolved) changed = {0, potentialField.rows(), 0, potentialField.cols()};
+			solveField(changed, 1e-5f);
+			fieldSolved = true;
+		} else {
+			convertField(0.2f);
+			fieldSolved = false;
+		}
         
         usleep(200000);
     }
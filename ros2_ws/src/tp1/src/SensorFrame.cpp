@@ -0,0 +1,55 @@
+#include "SensorFrame.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+SensorFeed::SensorFeed()
+{
+    for (int r = 0; r < READERS; ++r) events_[r] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+SensorFeed::~SensorFeed()
+{
+    for (int r = 0; r < READERS; ++r) {
+        if (events_[r] >= 0) close(events_[r]);
+    }
+}
+
+void SensorFeed::publish(const SensorFrame& frame)
+{
+    for (int r = 0; r < READERS; ++r) {
+        SensorFrame& slot = buffers_[r].back();
+        slot.sonarSequence = frame.sonarSequence;
+        slot.laserSequence = frame.laserSequence;
+        slot.pose = frame.pose;
+        slot.sonarStamp = frame.sonarStamp;
+        slot.sonarPose = frame.sonarPose;
+        slot.laserStamp = frame.laserStamp;
+        slot.laserPose = frame.laserPose;
+        slot.sonars.assign(frame.sonars.begin(), frame.sonars.end());
+        slot.lasers.assign(frame.lasers.begin(), frame.lasers.end());
+        buffers_[r].publish();
+
+        // O eventfd soma as escritas, então um aviso dado antes de o leitor dormir não se perde
+        if (events_[r] >= 0) {
+            uint64_t one = 1;
+            ssize_t written = write(events_[r], &one, sizeof(one));
+            (void)written;  // só falha com o contador cheio, quando já há avisos pendentes
+        }
+    }
+}
+
+bool SensorFeed::wait(Reader reader, int timeoutMs)
+{
+    if (events_[reader] < 0) {
+        usleep(timeoutMs * 1000);
+        return true;
+    }
+
+    pollfd event = {events_[reader], POLLIN, 0};
+    if (poll(&event, 1, timeoutMs) <= 0) return false;
+
+    uint64_t count;
+    return read(events_[reader], &count, sizeof(count)) == sizeof(count);
+}
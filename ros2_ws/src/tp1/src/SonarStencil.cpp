@@ -0,0 +1,58 @@
+#include "SonarStencil.hpp"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+SonarStencilCache::SonarStencilCache(int bins)
+    : range_(0.0f), beta_(0.0f), step_(0.0f), stencils_(bins), built_(bins, false)
+{
+}
+
+void SonarStencilCache::configure(float range, float beta, float step)
+{
+    if (range == range_ && beta == beta_ && step == step_) return;
+
+    range_ = range;
+    beta_ = beta;
+    step_ = step;
+    std::fill(built_.begin(), built_.end(), false);
+}
+
+const std::vector<StencilCell>& SonarStencilCache::get(float globalAngle)
+{
+    int bins = stencils_.size();
+    float turn = globalAngle / (2.0f * M_PI);
+    int bin = static_cast<int>(std::lround((turn - std::floor(turn)) * bins)) % bins;
+
+    if (!built_[bin]) build(bin);
+    return stencils_[bin];
+}
+
+void SonarStencilCache::build(int bin)
+{
+    std::vector<StencilCell>& cone = stencils_[bin];
+    cone.clear();
+
+    float axis = 2.0f * M_PI * bin / stencils_.size();
+    int reach = static_cast<int>(std::ceil(range_ / step_));
+
+    for (int dLinha = -reach; dLinha <= reach; ++dLinha) {
+        for (int dColuna = -reach; dColuna <= reach; ++dColuna) {
+            float dx = dColuna * step_;
+            float dy = dLinha * step_;
+
+            float distance = std::sqrt(dx * dx + dy * dy);
+            float relativeAngle = RAD2DEG(normalizeAngleRAD(std::atan2(dy, dx) - axis));
+
+            if (distance <= range_ && relativeAngle >= -beta_ && relativeAngle <= beta_) {
+                cone.push_back({dLinha, dColuna, distance, relativeAngle});
+            }
+        }
+    }
+
+    std::sort(cone.begin(), cone.end(), [](const StencilCell& a, const StencilCell& b) {
+        return a.distancia < b.distancia;
+    });
+    built_[bin] = true;
+}
@@ -0,0 +1,315 @@
+#include "Stencil.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STENCIL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+float sorRowScalar(float* row, const float* up, const float* down, int begin, int end, int parity, float omega)
+{
+    float error = 0.0f;
+    for (int x = begin + ((begin ^ parity) & 1); x < end; x += 2) {
+        if (row[x] == 1.0f) continue;
+
+        float residual = 0.25f * (up[x] + down[x] + row[x - 1] + row[x + 1]) - row[x];
+        row[x] += omega * residual;
+        error += residual * residual;
+    }
+    return error;
+}
+
+void smoothRowScalar(float* u, const float* up, const float* down, const float* rhs,
+                     const uint8_t* fixed, int begin, int end, int parity)
+{
+    for (int x = begin + ((begin ^ parity) & 1); x < end; x += 2) {
+        if (fixed[x]) continue;
+        u[x] = 0.25f * (up[x] + down[x] + u[x - 1] + u[x + 1] + rhs[x]);
+    }
+}
+
+float residualRowScalar(float* residual, const float* u, const float* up, const float* down,
+                        const float* rhs, const uint8_t* fixed, int begin, int end)
+{
+    float largest = 0.0f;
+    for (int x = begin; x < end; ++x) {
+        residual[x] = fixed[x] ? 0.0f : rhs[x] + up[x] + down[x] + u[x - 1] + u[x + 1] - 4.0f * u[x];
+        largest = std::max(largest, std::abs(residual[x]));
+    }
+    return largest;
+}
+
+#ifdef STENCIL_X86
+
+// Nas versões vetoriais todas as raias calculam e a máscara escolhe quais são gravadas: a cor
+// (raias alternadas, fixas na linha porque os blocos andam de 8 ou 4 células) e a condição de
+// célula livre. As somas seguem a mesma ordem das escalares e não há FMA, então os valores
+// gravados são idênticos. As células que sobram no fim da linha vão para a versão escalar.
+// As funções AVX2 reduzem os acumuladores a 128 bits e limpam a metade alta dos registradores
+// (vzeroupper) antes de voltar ao código SSE, que senão fica até 3 vezes mais lento; com o
+// atributo target o compilador não faz isso sozinho.
+
+__attribute__((target("avx2")))
+__m256 colorMask256(int begin, int parity)
+{
+    __m256i even = _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+    __m256i odd = _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    return _mm256_castsi256_ps(((begin ^ parity) & 1) ? odd : even);
+}
+
+// Máscara das células livres (fixed == 0) de 8 bytes de 'fixed'
+__attribute__((target("avx2")))
+__m256 freeMask256(const uint8_t* fixed)
+{
+    __m256i flags = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(fixed)));
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(flags, _mm256_setzero_si256()));
+}
+
+// Vizinhos x - 1 e x + 1 do bloco 'center' montados a partir dos blocos anterior e seguinte.
+// Nas varreduras que gravam na própria linha, reler x - 1 da memória pegaria metade do bloco
+// que acabou de ser gravado, e o processador não consegue repassar a gravação para essa leitura.
+__attribute__((target("avx2")))
+inline void neighbors256(__m256 previous, __m256 center, __m256 next, __m256& left, __m256& right)
+{
+    __m256i c = _mm256_castps_si256(center);
+    __m256i low = _mm256_castps_si256(_mm256_permute2f128_ps(previous, center, 0x21));
+    __m256i high = _mm256_castps_si256(_mm256_permute2f128_ps(center, next, 0x21));
+    left = _mm256_castsi256_ps(_mm256_alignr_epi8(c, low, 12));
+    right = _mm256_castsi256_ps(_mm256_alignr_epi8(high, c, 4));
+}
+
+__attribute__((target("avx2")))
+float sorRowAvx2(float* row, const float* up, const float* down, int begin, int end, int parity, float omega)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 w = _mm256_set1_ps(omega);
+    const __m256 color = colorMask256(begin, parity);
+    __m256 error = _mm256_setzero_ps();
+
+    // O bloco seguinte é lido antes de gravar o atual; as células da outra cor, que são as
+    // vizinhas usadas, não mudam nesta meia varredura
+    int x = begin;
+    __m256 previous = _mm256_set1_ps(row[x - 1]), center = _mm256_loadu_ps(row + x);
+    for (; x + 16 <= end + 1; x += 8) {
+        __m256 next = _mm256_loadu_ps(row + x + 8), left, right;
+        neighbors256(previous, center, next, left, right);
+
+        __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(up + x), _mm256_loadu_ps(down + x)), left), right);
+        __m256 update = _mm256_and_ps(color, _mm256_cmp_ps(center, one, _CMP_NEQ_UQ));
+        __m256 residual = _mm256_and_ps(_mm256_sub_ps(_mm256_mul_ps(quarter, sum), center), update);
+
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(center, _mm256_add_ps(center, _mm256_mul_ps(w, residual)), update));
+        error = _mm256_add_ps(error, _mm256_mul_ps(residual, residual));
+        previous = center;
+        center = next;
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(_mm256_castps256_ps128(error), _mm256_extractf128_ps(error, 1)));
+    _mm256_zeroupper();
+    float total = 0.0f;
+    for (float lane : lanes) total += lane;
+    return total + sorRowScalar(row, up, down, x, end, parity, omega);
+}
+
+__attribute__((target("avx2")))
+void smoothRowAvx2(float* u, const float* up, const float* down, const float* rhs,
+                   const uint8_t* fixed, int begin, int end, int parity)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 color = colorMask256(begin, parity);
+
+    int x = begin;
+    __m256 previous = _mm256_set1_ps(u[x - 1]), center = _mm256_loadu_ps(u + x);
+    for (; x + 16 <= end + 1; x += 8) {
+        __m256 next = _mm256_loadu_ps(u + x + 8), left, right;
+        neighbors256(previous, center, next, left, right);
+
+        __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(up + x), _mm256_loadu_ps(down + x)), left), right),
+                                   _mm256_loadu_ps(rhs + x));
+        __m256 update = _mm256_and_ps(color, freeMask256(fixed + x));
+        _mm256_storeu_ps(u + x, _mm256_blendv_ps(center, _mm256_mul_ps(quarter, sum), update));
+        previous = center;
+        center = next;
+    }
+    _mm256_zeroupper();
+    smoothRowScalar(u, up, down, rhs, fixed, x, end, parity);
+}
+
+__attribute__((target("avx2")))
+float residualRowAvx2(float* residual, const float* u, const float* up, const float* down,
+                      const float* rhs, const uint8_t* fixed, int begin, int end)
+{
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 largest = _mm256_setzero_ps();
+
+    int x = begin;
+    for (; x + 8 <= end; x += 8) {
+        __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(rhs + x), _mm256_loadu_ps(up + x)),
+                                                               _mm256_loadu_ps(down + x)),
+                                                 _mm256_loadu_ps(u + x - 1)),
+                                   _mm256_loadu_ps(u + x + 1));
+        __m256 r = _mm256_and_ps(_mm256_sub_ps(sum, _mm256_mul_ps(four, _mm256_loadu_ps(u + x))), freeMask256(fixed + x));
+        _mm256_storeu_ps(residual + x, r);
+        largest = _mm256_max_ps(largest, _mm256_andnot_ps(sign, r));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_max_ps(_mm256_castps256_ps128(largest), _mm256_extractf128_ps(largest, 1)));
+    _mm256_zeroupper();
+    float total = residualRowScalar(residual, u, up, down, rhs, fixed, x, end);
+    for (float lane : lanes) total = std::max(total, lane);
+    return total;
+}
+
+__attribute__((target("sse4.1")))
+__m128 colorMask128(int begin, int parity)
+{
+    return _mm_castsi128_ps(((begin ^ parity) & 1) ? _mm_setr_epi32(0, -1, 0, -1) : _mm_setr_epi32(-1, 0, -1, 0));
+}
+
+// Máscara das células livres (fixed == 0) de 4 bytes de 'fixed'
+__attribute__((target("sse4.1")))
+__m128 freeMask128(const uint8_t* fixed)
+{
+    int32_t word;
+    std::memcpy(&word, fixed, sizeof(word));
+    __m128i flags = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(word));
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(flags, _mm_setzero_si128()));
+}
+
+__attribute__((target("sse4.1")))
+inline void neighbors128(__m128 previous, __m128 center, __m128 next, __m128& left, __m128& right)
+{
+    __m128i c = _mm_castps_si128(center);
+    left = _mm_castsi128_ps(_mm_alignr_epi8(c, _mm_castps_si128(previous), 12));
+    right = _mm_castsi128_ps(_mm_alignr_epi8(_mm_castps_si128(next), c, 4));
+}
+
+__attribute__((target("sse4.1")))
+float sorRowSse41(float* row, const float* up, const float* down, int begin, int end, int parity, float omega)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 w = _mm_set1_ps(omega);
+    const __m128 color = colorMask128(begin, parity);
+    __m128 error = _mm_setzero_ps();
+
+    int x = begin;
+    __m128 previous = _mm_set1_ps(row[x - 1]), center = _mm_loadu_ps(row + x);
+    for (; x + 8 <= end + 1; x += 4) {
+        __m128 next = _mm_loadu_ps(row + x + 4), left, right;
+        neighbors128(previous, center, next, left, right);
+
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x)), left), right);
+        __m128 update = _mm_and_ps(color, _mm_cmpneq_ps(center, one));
+        __m128 residual = _mm_and_ps(_mm_sub_ps(_mm_mul_ps(quarter, sum), center), update);
+
+        _mm_storeu_ps(row + x, _mm_blendv_ps(center, _mm_add_ps(center, _mm_mul_ps(w, residual)), update));
+        error = _mm_add_ps(error, _mm_mul_ps(residual, residual));
+        previous = center;
+        center = next;
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, error);
+    float total = 0.0f;
+    for (float lane : lanes) total += lane;
+    return total + sorRowScalar(row, up, down, x, end, parity, omega);
+}
+
+__attribute__((target("sse4.1")))
+void smoothRowSse41(float* u, const float* up, const float* down, const float* rhs,
+                    const uint8_t* fixed, int begin, int end, int parity)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 color = colorMask128(begin, parity);
+
+    int x = begin;
+    __m128 previous = _mm_set1_ps(u[x - 1]), center = _mm_loadu_ps(u + x);
+    for (; x + 8 <= end + 1; x += 4) {
+        __m128 next = _mm_loadu_ps(u + x + 4), left, right;
+        neighbors128(previous, center, next, left, right);
+
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x)), left), right),
+                                _mm_loadu_ps(rhs + x));
+        __m128 update = _mm_and_ps(color, freeMask128(fixed + x));
+        _mm_storeu_ps(u + x, _mm_blendv_ps(center, _mm_mul_ps(quarter, sum), update));
+        previous = center;
+        center = next;
+    }
+    smoothRowScalar(u, up, down, rhs, fixed, x, end, parity);
+}
+
+__attribute__((target("sse4.1")))
+float residualRowSse41(float* residual, const float* u, const float* up, const float* down,
+                       const float* rhs, const uint8_t* fixed, int begin, int end)
+{
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 largest = _mm_setzero_ps();
+
+    int x = begin;
+    for (; x + 4 <= end; x += 4) {
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(rhs + x), _mm_loadu_ps(up + x)),
+                                                      _mm_loadu_ps(down + x)),
+                                           _mm_loadu_ps(u + x - 1)),
+                                _mm_loadu_ps(u + x + 1));
+        __m128 r = _mm_and_ps(_mm_sub_ps(sum, _mm_mul_ps(four, _mm_loadu_ps(u + x))), freeMask128(fixed + x));
+        _mm_storeu_ps(residual + x, r);
+        largest = _mm_max_ps(largest, _mm_andnot_ps(sign, r));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, largest);
+    float total = residualRowScalar(residual, u, up, down, rhs, fixed, x, end);
+    for (float lane : lanes) total = std::max(total, lane);
+    return total;
+}
+
+#endif // STENCIL_X86
+
+const StencilKernels SCALAR_KERNELS = {"escalar", sorRowScalar, smoothRowScalar, residualRowScalar};
+#ifdef STENCIL_X86
+const StencilKernels SSE41_KERNELS = {"SSE4.1", sorRowSse41, smoothRowSse41, residualRowSse41};
+const StencilKernels AVX2_KERNELS = {"AVX2", sorRowAvx2, smoothRowAvx2, residualRowAvx2};
+#endif
+
+}
+
+bool stencilSupported(StencilIsa isa)
+{
+    switch (isa) {
+#ifdef STENCIL_X86
+    case STENCIL_AVX2: return __builtin_cpu_supports("avx2");
+    case STENCIL_SSE41: return __builtin_cpu_supports("sse4.1");
+#endif
+    case STENCIL_SCALAR: return true;
+    default: return false;
+    }
+}
+
+const StencilKernels& stencilKernels(StencilIsa isa)
+{
+    if (!stencilSupported(isa)) return SCALAR_KERNELS;
+#ifdef STENCIL_X86
+    if (isa == STENCIL_AVX2) return AVX2_KERNELS;
+    if (isa == STENCIL_SSE41) return SSE41_KERNELS;
+#endif
+    return SCALAR_KERNELS;
+}
+
+const StencilKernels& stencilKernels()
+{
+    static const StencilKernels& best = stencilSupported(STENCIL_AVX2) ? stencilKernels(STENCIL_AVX2)
+                                      : stencilSupported(STENCIL_SSE41) ? stencilKernels(STENCIL_SSE41)
+                                      : stencilKernels(STENCIL_SCALAR);
+    return best;
+}
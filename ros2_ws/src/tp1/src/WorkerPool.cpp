@@ -0,0 +1,86 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threads)
+{
+    for (int w = 1; w < threads; ++w) threads_.emplace_back(&WorkerPool::work, this, w);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    started_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+}
+
+void WorkerPool::run(int count, const std::function<void(int, int)>& task)
+{
+    if (count <= 0) return;
+
+    // Sem threads extras ou com uma tarefa só não vale acordar ninguém
+    if (threads_.empty() || count == 1) {
+        for (int t = 0; t < count; ++t) task(t, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        running_ = static_cast<int>(threads_.size());
+        ++generation_;
+    }
+    started_.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this] { return running_ == 0; });
+    task_ = nullptr;
+}
+
+int WorkerPool::bands(int rows, int minRows) const
+{
+    return std::max(1, std::min(workers(), rows / std::max(1, minRows)));
+}
+
+void WorkerPool::runBands(int rows, int minRows, const std::function<void(int, int, int)>& band)
+{
+    int count = bands(rows, minRows);
+    run(count, [&](int b, int) {
+        band(static_cast<int>(static_cast<long>(rows) * b / count),
+             static_cast<int>(static_cast<long>(rows) * (b + 1) / count), b);
+    });
+}
+
+void WorkerPool::drain(int worker)
+{
+    for (int t = next_.fetch_add(1, std::memory_order_relaxed); t < count_;
+         t = next_.fetch_add(1, std::memory_order_relaxed)) {
+        (*task_)(t, worker);
+    }
+}
+
+void WorkerPool::work(int worker)
+{
+    unsigned long seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            started_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+
+        drain(worker);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--running_ == 0) finished_.notify_one();
+    }
+}
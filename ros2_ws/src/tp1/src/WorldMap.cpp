@@ -0,0 +1,342 @@
+#include "WorldMap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+bool tileBefore(const StoredTile& a, const StoredTile& b)
+{
+    return a.tile.linha != b.tile.linha ? a.tile.linha < b.tile.linha : a.tile.coluna < b.tile.coluna;
+}
+
+}
+
+WorldMap::WorldMap(const GridInfo& info, int initial, int options)
+    : initial_(initial)
+{
+    // A janela densa cobre blocos inteiros, assim cada bloco é todo denso ou todo esparso
+    int cells = static_cast<int>((info.fim - info.inicio) / info.passo);
+    cells = (cells + TILE - 1) / TILE * TILE;
+    cells_.reset(cells, cells, info, initial);
+
+    blank_.cells.fill(initial);
+    blank_.dirty = false;
+    resetTiles();
+
+    if (options & WITH_PYRAMID) {
+        pyramid_.reset(new MapPyramid());
+        pyramid_->build(cells_);
+    }
+    publishView();
+}
+
+WorldMap::~WorldMap()
+{
+    view_.reset();
+    delete recycled_.exchange(nullptr);
+}
+
+void WorldMap::cellChanged(const MatrixPosition& pos, int before, int after)
+{
+    if (pyramid_) pyramid_->update(pos.linha, pos.coluna, before, after);
+}
+
+void WorldMap::decrementTiles(const std::vector<CellDecrement>& cells, const std::vector<int>& tileStarts,
+                              WorkerPool& pool)
+{
+    int tiles = static_cast<int>(tileStarts.size()) - 1;
+    if (tiles <= 0) return;
+
+    // Journal, snapshot e versões são preparados aqui; depois cada thread só mexe nos bytes dos
+    // seus blocos, que nunca dividem um byte com outro bloco
+    for (int t = 0; t < tiles; ++t) beforeWrite(cells[tileStarts[t]].pos);
+
+    bool mirrored = pyramid_ != nullptr;
+    changes_.resize(pool.workers());
+    pool.run(tiles, [&](int t, int worker) {
+        std::vector<CellChange>& changes = changes_[worker];
+        for (int i = tileStarts[t]; i < tileStarts[t + 1]; ++i) {
+            const MatrixPosition& pos = cells[i].pos;
+            int before = cells_.get(pos);
+            cells_.set(pos, before - cells[i].amount);
+            if (mirrored && cells_.get(pos) != before) changes.push_back({pos, before, cells_.get(pos)});
+        }
+    });
+
+    for (std::vector<CellChange>& changes : changes_) {
+        for (const CellChange& change : changes) cellChanged(change.pos, change.before, change.after);
+        changes.clear();
+    }
+}
+
+int WorldMap::getSparse(int linha, int coluna) const
+{
+    int tileLinha = tileOf(linha), tileColuna = tileOf(coluna);
+    const SparseTile* tile = sparse_.find(tileLinha, tileColuna);
+    if (!tile) return initial_;
+    return tile->cells.get(linha - tileLinha * TILE, coluna - tileColuna * TILE);
+}
+
+void WorldMap::setSparse(const MatrixPosition& pos, int value)
+{
+    int tileLinha = tileOf(pos.linha), tileColuna = tileOf(pos.coluna);
+    SparseTile& tile = sparse_.obtain(tileLinha, tileColuna, blank_);
+
+    if (!tile.dirty) {
+        tile.dirty = true;
+        dirtyTiles_.push_back({tileLinha, tileColuna});
+        dirtyCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    tile.cells.set(pos.linha - tileLinha * TILE, pos.coluna - tileColuna * TILE, value);
+}
+
+void WorldMap::resetTiles()
+{
+    tileRows_ = (cells_.rows() + TILE - 1) / TILE;
+    tileColumns_ = (cells_.cols() + TILE - 1) / TILE;
+
+    int tiles = tileRows_ * tileColumns_;
+    tileEpoch_.reset(new std::atomic<uint32_t>[tiles]);
+    for (int t = 0; t < tiles; ++t) tileEpoch_[t].store(epoch_.load());
+
+    dirty_.assign(tiles, 0);
+    dirtyTiles_.clear();
+    dirtyTiles_.reserve(tiles);
+    snapshotTiles_.clear();
+    snapshotTiles_.reserve(tiles);
+    sparse_.forEach([](const MatrixPosition&, SparseTile& tile) { tile.dirty = false; });
+    dirtyCount_ = 0;
+
+    tileVersion_.assign(tiles, 0);
+    viewReset_ = true;
+}
+
+void WorldMap::markDirty(int tile)
+{
+    dirty_[tile] = 1;
+    dirtyTiles_.push_back({tile / tileColumns_, tile % tileColumns_});
+    dirtyCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool WorldMap::replace(NibbleGrid&& cells, std::vector<StoredTile>&& sparse)
+{
+    if (busy_.load()) return false;
+
+    // Mapas gravados com uma janela que não cobre blocos inteiros são completados
+    if (cells.rows() % TILE != 0 || cells.cols() % TILE != 0) {
+        NibbleGrid padded((cells.rows() + TILE - 1) / TILE * TILE, (cells.cols() + TILE - 1) / TILE * TILE,
+                          cells.info(), initial_);
+        for (int linha = 0; linha < cells.rows(); ++linha) {
+            std::memcpy(padded.row(linha), cells.row(linha), cells.cols() / 2);
+            if (cells.cols() % 2) padded.set(linha, cells.cols() - 1, cells.get(linha, cells.cols() - 1));
+        }
+        cells = std::move(padded);
+    }
+
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+    replacement_.reset(new Replacement{std::move(cells), std::move(sparse)});
+    return true;
+}
+
+void WorldMap::install(NibbleGrid&& cells, std::vector<StoredTile>&& sparse)
+{
+    // A pirâmide guarda um ponteiro para cells_: solta antes de a grade ser trocada
+    if (pyramid_) pyramid_->detach();
+    cells_ = std::move(cells);
+
+    tileRows_ = cells_.rows() / TILE;
+    tileColumns_ = cells_.cols() / TILE;
+    sparse_.clear();
+    for (const StoredTile& stored : sparse) {
+        if (isDenseTile(stored.tile)) {
+            for (int l = 0; l < TILE; ++l) {
+                std::memcpy(cells_.row(stored.tile.linha * TILE + l) + stored.tile.coluna * TILE / 2,
+                            stored.cells.bytes[l], TILE / 2);
+            }
+        } else {
+            sparse_.obtain(stored.tile.linha, stored.tile.coluna, blank_).cells = stored.cells;
+        }
+    }
+
+    resetTiles();
+    if (pyramid_) pyramid_->build(cells_);
+}
+
+void WorldMap::publishView()
+{
+    uint64_t current = viewVersion_;
+    if (!viewReset_ && std::none_of(tileVersion_.begin(), tileVersion_.end(),
+                                    [current](uint64_t version) { return version > current; })) {
+        return;
+    }
+
+    // Uma versão antiga que nenhum leitor segura mais é reaproveitada: basta copiar os blocos
+    // escritos depois dela (se for de antes de um mapa carregado, pode nem ter o mesmo tamanho)
+    MapView* next = recycled_.exchange(nullptr, std::memory_order_acquire);
+    bool fresh = !next || viewReset_ || next->cells.rows() != cells_.rows() || next->cells.cols() != cells_.cols();
+    if (!fresh) {
+        for (int t = 0; t < tileRows_ * tileColumns_; ++t) {
+            if (tileVersion_[t] > next->version) copyTile(t, next->cells);
+        }
+    } else {
+        delete next;
+        next = new MapView{0, cells_, {}, {}};
+    }
+
+    // No nível TILE_LEVEL da pirâmide cada bloco é uma célula: o máximo dele sai de uma consulta
+    if (pyramid_) {
+        next->tileMax.resize(tileRows_ * tileColumns_);
+        for (int t = 0; t < tileRows_ * tileColumns_; ++t) {
+            if (fresh || tileVersion_[t] > next->version) {
+                next->tileMax[t] = pyramid_->blockMax(TILE_LEVEL, t / tileColumns_, t % tileColumns_);
+            }
+        }
+    }
+    next->version = ++viewVersion_;
+    if (viewReset_) std::fill(tileVersion_.begin(), tileVersion_.end(), viewVersion_);
+    next->tileVersion = tileVersion_;
+    viewReset_ = false;
+
+    std::shared_ptr<const MapView> published(next, [this](const MapView* view) {
+        recycle(const_cast<MapView*>(view));
+    });
+    std::atomic_store(&view_, std::move(published));
+}
+
+void WorldMap::recycle(MapView* view)
+{
+    // Chamado pelo último leitor da versão; só uma fica guardada, as demais são liberadas
+    MapView* expected = nullptr;
+    if (!recycled_.compare_exchange_strong(expected, view, std::memory_order_release)) delete view;
+}
+
+bool WorldMap::requestSnapshot()
+{
+    bool expected = false;
+    if (!busy_.compare_exchange_strong(expected, true)) return false;
+
+    // Sob o mutex a grade não é trocada por um mapa carregado (ver syncPoint)
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+
+    // A cópia tem o mesmo formato da grade, então cada bloco é copiado byte a byte
+    if (snapshot_.rows() != cells_.rows() || snapshot_.cols() != cells_.cols()) {
+        snapshot_.reset(cells_.rows(), cells_.cols(), cells_.info(), 0);
+    }
+
+    requested_ = true;
+    return true;
+}
+
+void WorldMap::syncPoint()
+{
+    std::lock_guard<std::mutex> lock(snapshotMutex_);
+
+    // Com um snapshot em andamento a troca espera: a thread de gravação ainda lê os blocos
+    if (replacement_ && !busy_.load()) {
+        install(std::move(replacement_->cells), std::move(replacement_->sparse));
+        replacement_.reset();
+        publishView();
+    }
+
+    if (!requested_) return;
+
+    uint32_t next = epoch_.load() + 1;
+    if (next == BUSY) next = 0;
+    epoch_.store(next, std::memory_order_release);
+
+    // Os blocos sujos até aqui vão para este snapshot; os próximos começam do zero
+    snapshotTiles_.swap(dirtyTiles_);
+    dirtyTiles_.clear();
+    for (const MatrixPosition& tile : snapshotTiles_) {
+        if (isDenseTile(tile)) dirty_[tile.linha * tileColumns_ + tile.coluna] = 0;
+        else sparse_.find(tile.linha, tile.coluna)->dirty = false;
+    }
+    dirtyCount_ = 0;
+
+    // Os blocos esparsos não têm copy-on-write: são copiados aqui, em proporção à área explorada
+    snapshotSparse_.clear();
+    sparse_.forEach([this](const MatrixPosition& position, const SparseTile& tile) {
+        snapshotSparse_.push_back({position, tile.cells});
+    });
+
+    requested_ = false;
+    active_ = true;
+    snapshotStarted_.notify_all();
+}
+
+const NibbleGrid* WorldMap::completeSnapshot(std::chrono::milliseconds timeout)
+{
+    {
+        std::unique_lock<std::mutex> lock(snapshotMutex_);
+        if (!snapshotStarted_.wait_for(lock, timeout, [this] { return active_; })) return nullptr;
+    }
+
+    uint32_t epoch = epoch_.load(std::memory_order_acquire);
+    for (int t = 0; t < tileRows_ * tileColumns_; ++t) preserveTile(t, epoch);
+
+    std::sort(snapshotSparse_.begin(), snapshotSparse_.end(), tileBefore);
+    return &snapshot_;
+}
+
+void WorldMap::snapshotTile(const MatrixPosition& tile, StoredTile& out) const
+{
+    out.tile = tile;
+
+    if (isDenseTile(tile)) {
+        for (int l = 0; l < TILE; ++l) {
+            std::memcpy(out.cells.bytes[l], snapshot_.row(tile.linha * TILE + l) + tile.coluna * TILE / 2, TILE / 2);
+        }
+        return;
+    }
+
+    auto it = std::lower_bound(snapshotSparse_.begin(), snapshotSparse_.end(), out, tileBefore);
+    if (it != snapshotSparse_.end() && it->tile.linha == tile.linha && it->tile.coluna == tile.coluna) {
+        out.cells = it->cells;
+    } else {
+        out.cells = blank_.cells;
+    }
+}
+
+void WorldMap::releaseSnapshot()
+{
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex_);
+        requested_ = false;
+        active_ = false;
+    }
+    busy_.store(false);
+}
+
+void WorldMap::preserveTile(int tile, uint32_t epoch)
+{
+    std::atomic<uint32_t>& state = tileEpoch_[tile];
+
+    while (true) {
+        uint32_t current = state.load(std::memory_order_acquire);
+        if (current == epoch) return;
+
+        // Outra thread está copiando este bloco agora
+        if (current == BUSY) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (state.compare_exchange_weak(current, BUSY, std::memory_order_acq_rel)) {
+            copyTile(tile, snapshot_);
+            state.store(epoch, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void WorldMap::copyTile(int tile, NibbleGrid& to) const
+{
+    int firstLine = (tile / tileColumns_) * TILE,
+        firstByte = (tile % tileColumns_) * TILE / 2;
+
+    for (int linha = firstLine; linha < firstLine + TILE; ++linha) {
+        std::memcpy(to.row(linha) + firstByte, cells_.row(linha) + firstByte, TILE / 2);
+    }
+}
@@ -12,11 +12,15 @@
 #include "graphics.hpp"
 #include "Mapping.hpp"
 #include "PotentialField.hpp"
+#include "SensorFrame.hpp"
 
 using std::placeholders::_1;
 using namespace std::chrono_literals;
 char pressedKey;
 
+extern BitGrid knownRegion;  // PotentialField.cpp
+extern SensorFeed sensorFeed;  // Mapping.cpp
+
 class NavigationNode : public rclcpp::Node
 {
   public:
@@ -43,6 +47,26 @@ class NavigationNode : public rclcpp::Node
       std::cout << "Read " << lasers.size() << " laser measurements" << std::endl;
       std::cout << "Read " << sonars.size() << " sonar measurements" << std::endl;
       std::cout << "Read " << pose.size() << " pose measurements" << std::endl;
+      std::cout << "Explored " << knownRegion.coverage() * 100.0f << "% of the map" << std::endl;
+
+      // Os callbacks e este timer rodam no mesmo executor, então a sequência corresponde às leituras acima
+      if (pose.size() >= 3)
+      {
+        frame_.sonarSequence = perception_.getSonarSequence();
+        frame_.laserSequence = perception_.getLaserSequence();
+        frame_.pose = {pose[0], pose[1], pose[2]};
+
+        // Pose de cada sensor no instante da sua leitura (a odometria chega em outro ritmo)
+        frame_.sonarStamp = perception_.getLatestSonarStamp();
+        frame_.laserStamp = perception_.getLatestLaserStamp();
+        std::vector<float> sonarPose = perception_.getPoseAt(frame_.sonarStamp);
+        std::vector<float> laserPose = perception_.getPoseAt(frame_.laserStamp);
+        frame_.sonarPose = sonarPose.empty() ? frame_.pose : Position{sonarPose[0], sonarPose[1], sonarPose[2]};
+        frame_.laserPose = laserPose.empty() ? frame_.pose : Position{laserPose[0], laserPose[1], laserPose[2]};
+        frame_.sonars = sonars;
+        frame_.lasers = lasers;
+        sensorFeed.publish(frame_);
+      }
 
       // Get keyboard input
       char ch = pressedKey;
@@ -88,6 +112,7 @@ class NavigationNode : public rclcpp::Node
 
     Action &action_;
     Perception &perception_;
+    SensorFrame frame_;
 };
 
 void *keyboardThreadFunction(void *arg)